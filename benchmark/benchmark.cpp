@@ -0,0 +1,562 @@
+/**
+ * File: benchmark.cpp
+ * -------------------
+ * Runs every engine over a matrix of workloads and reports how fast each
+ * one goes as JSON:
+ *
+ *    benchmark [--engines simple,parallel] [--patterns DIR] [--sizes 64,256,...]
+ *              [--densities 10,20,...] [--min-time SECONDS] [--threads N]
+ *              [--seed N] [--output FILE] [--baseline FILE] [--threshold FRACTION]
+ *              [--counters on|off]
+ *
+ * The workloads are every pattern file in DIR (res/files by default) at its
+ * own size, plus random soups of each density (percent of live cells) at
+ * each size (rows = columns), generated from --seed (see soup.h). Files that
+ * cannot be read as patterns are skipped with a warning. Each case
+ * runs for at least --min-time seconds and reports generations per second,
+ * cells per nanosecond, the peak resident set size and the number of heap
+ * allocations per generation.
+ * With --counters on, each case also reports hardware counters per
+ * generation (cycles, instructions, L1 data and last level cache misses,
+ * branch misses) where perf_event_open allows it; counters the system does
+ * not provide are left out of the report, with the reason given once.
+ *
+ * With --baseline, each case is compared with the case of the same name in
+ * an earlier report; cases whose generations per second dropped by more than
+ * --threshold (default 0.1, i.e. 10%) are flagged as regressions, listed on
+ * standard error, and make the program exit with status 2.
+ */
+
+#include <cctype>    // for isspace
+#include <chrono>    // for steady_clock
+#include <fstream>   // for ifstream, ofstream
+#include <iostream>  // for cout, cerr
+#include <map>       // for std::map
+#include <memory>    // for std::unique_ptr
+#include <sstream>   // for ostringstream
+#include <stdexcept> // for invalid_argument
+#include <string>    // for string
+#include <vector>    // for vector
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>   // for GetProcessMemoryInfo
+#else
+#include <sys/resource.h> // for getrusage
+#endif
+
+#include "simulationgrid.h"
+#include "liferule.h"
+#include "lifeengine.h"
+#include "patternio.h"
+#include "soup.h"
+#include "perfcounters.h"
+#include "memorytracker.h"
+#include "tracing.h"
+
+namespace {
+
+/*
+ * Every heap allocation in the program goes through the tracker's operator
+ * new, so this catches the engines' allocations as well as the standard
+ * library's, whichever subsystem they are attributed to.
+ */
+long long countAllocations() {
+    MemoryTracker::Snapshot snapshot = MemoryTracker::getSnapshot();
+    long long allocations = 0;
+    for (int i = 0; i < MemoryTracker::kNumSubsystems; i++) {
+        allocations += snapshot.usage[i].allocations;
+    }
+    return allocations;
+}
+
+struct Options {
+    std::vector<std::string> engines = LifeEngine::getEngineNames();
+    std::string patternDirectory = "res/files";
+    std::vector<int> sizes = { 64, 256, 1024, 4096, 16384 };
+    std::vector<int> densities = { 10, 20, 30, 40, 50 };
+    double minTime = 0.5;
+    int threads = 0;
+    unsigned long long seed = 1;
+    std::string output;
+    std::string baseline;
+    double threshold = 0.1;
+    bool counters = false;
+};
+
+struct Workload {
+    std::string name;
+    std::string patternFile; // empty for a random soup
+    int size;
+    int density;
+};
+
+struct Result {
+    std::string name;
+    std::string engine;
+    std::string workload;
+    int rows;
+    int cols;
+    long long generations;
+    double seconds;
+    double generationsPerSecond;
+    double cellsPerNanosecond;
+    long long peakRssBytes;
+    double allocationsPerGeneration;
+    PerfCounters::Counts counts; // per generation; nothing valid without --counters
+    double baselineGenerationsPerSecond; // 0 if there is no baseline for this case
+    double change;                       // relative to the baseline
+    bool regression;
+};
+
+std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    std::istringstream input(text);
+    std::string part;
+    while (std::getline(input, part, separator)) {
+        if (!part.empty()) parts.push_back(part);
+    }
+    return parts;
+}
+
+std::vector<int> splitInts(const std::string& text) {
+    std::vector<int> values;
+    for (const std::string& part : split(text, ',')) {
+        values.push_back(std::stoi(part));
+    }
+    return values;
+}
+
+void usage(std::ostream& out) {
+    out << "usage: benchmark [--engines simple,parallel] [--patterns DIR] [--sizes 64,256,...]" << std::endl
+        << "                 [--densities 10,20,...] [--min-time SECONDS] [--threads N]" << std::endl
+        << "                 [--seed N] [--output FILE] [--baseline FILE] [--threshold FRACTION]" << std::endl
+        << "                 [--counters on|off]" << std::endl;
+}
+
+Options parseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("missing value for " + arg);
+        }
+        std::string value = argv[++i];
+        if (arg == "--engines") {
+            options.engines = split(value, ',');
+        }
+        else if (arg == "--patterns") {
+            options.patternDirectory = value;
+        }
+        else if (arg == "--sizes") {
+            options.sizes = splitInts(value);
+        }
+        else if (arg == "--densities") {
+            options.densities = splitInts(value);
+        }
+        else if (arg == "--min-time") {
+            options.minTime = std::stod(value);
+        }
+        else if (arg == "--threads") {
+            options.threads = std::stoi(value);
+        }
+        else if (arg == "--seed") {
+            options.seed = std::stoull(value);
+        }
+        else if (arg == "--output") {
+            options.output = value;
+        }
+        else if (arg == "--baseline") {
+            options.baseline = value;
+        }
+        else if (arg == "--threshold") {
+            options.threshold = std::stod(value);
+        }
+        else if (arg == "--counters") {
+            if (value != "on" && value != "off") {
+                throw std::invalid_argument("--counters must be on or off");
+            }
+            options.counters = value == "on";
+        }
+        else {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+    return options;
+}
+
+/**
+ * Function: resetPeakRss
+ * ----------------------
+ * Starts a new peak resident set size measurement, where the platform
+ * allows it (Linux 4.0 and later); elsewhere the peak covers the whole run.
+ */
+void resetPeakRss() {
+#ifdef __linux__
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    if (clearRefs) clearRefs << "5";
+#endif
+}
+
+long long getPeakRss() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<long long>(counters.PeakWorkingSetSize);
+    }
+    return 0;
+#else
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return std::stoll(line.substr(6)) * 1024; // reported in kB
+        }
+    }
+#endif
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss; // bytes on macOS
+#else
+    return usage.ru_maxrss * 1024LL; // kilobytes elsewhere
+#endif
+#endif
+}
+
+/**
+ * Function: runCase
+ * -----------------
+ * Runs one engine on one workload for at least options.minTime seconds.
+ * counters may be null; if not, it must have been created before the
+ * engine so that the engine's threads are counted too.
+ */
+Result runCase(LifeEngine& engine, const Workload& workload, const Options& options,
+               PerfCounters* counters) {
+    SimulationGrid grid;
+    if (workload.patternFile.empty()) {
+        fillRandomSoup(grid, workload.size, workload.size, options.seed, workload.density / 100.0);
+    }
+    else {
+        readPatternFile(workload.patternFile, grid);
+    }
+    SimulationGrid next;
+    LifeRule rule;
+    engine.step(grid, next, rule); // warm up: sizes next and faults its pages in
+    grid.swap(next);
+
+    resetPeakRss();
+    long long allocationsBefore = countAllocations();
+    long long generations = 0;
+    if (counters) counters->start();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double seconds = 0;
+    do {
+        engine.step(grid, next, rule);
+        grid.swap(next);
+        generations++;
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < options.minTime || generations < 2);
+    long long allocations = countAllocations() - allocationsBefore;
+    PerfCounters::Counts counts = {};
+    if (counters) counts = counters->stop();
+
+    Result result;
+    result.engine = engine.getName();
+    result.workload = workload.name;
+    result.rows = grid.getNumRows();
+    result.cols = grid.getNumCols();
+    std::ostringstream name;
+    name << result.engine << "/" << result.workload << "/" << result.rows << "x" << result.cols;
+    result.name = name.str();
+    result.generations = generations;
+    result.seconds = seconds;
+    result.generationsPerSecond = generations / seconds;
+    result.cellsPerNanosecond = static_cast<double>(result.rows) * result.cols * generations / seconds / 1e9;
+    result.peakRssBytes = getPeakRss();
+    result.allocationsPerGeneration = static_cast<double>(allocations) / generations;
+    result.counts = counts;
+    for (int i = 0; i < PerfCounters::kNumEvents; i++) {
+        result.counts.values[i] /= generations;
+    }
+    result.baselineGenerationsPerSecond = 0;
+    result.change = 0;
+    result.regression = false;
+    return result;
+}
+
+void writeReport(std::ostream& out, const std::vector<Result>& results, bool withBaseline,
+                 const std::string& countersError) {
+    out << "{\n  \"benchmark\": \"game-of-life\",";
+    if (!countersError.empty()) {
+        out << "\n  \"counters_unavailable\": " << quoteJson(countersError) << ",";
+    }
+    out << "\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {"
+            << "\"name\": " << quoteJson(r.name)
+            << ", \"engine\": " << quoteJson(r.engine)
+            << ", \"workload\": " << quoteJson(r.workload)
+            << ", \"rows\": " << r.rows
+            << ", \"cols\": " << r.cols
+            << ", \"generations\": " << r.generations
+            << ", \"seconds\": " << r.seconds
+            << ", \"generations_per_second\": " << r.generationsPerSecond
+            << ", \"cells_per_ns\": " << r.cellsPerNanosecond
+            << ", \"peak_rss_bytes\": " << r.peakRssBytes
+            << ", \"allocations_per_generation\": " << r.allocationsPerGeneration;
+        for (int e = 0; e < PerfCounters::kNumEvents; e++) {
+            if (r.counts.valid[e]) {
+                PerfCounters::Event event = static_cast<PerfCounters::Event>(e);
+                out << ", \"" << PerfCounters::getEventName(event) << "_per_generation\": " << r.counts.values[e];
+            }
+        }
+        if (withBaseline && r.baselineGenerationsPerSecond > 0) {
+            out << ", \"baseline_generations_per_second\": " << r.baselineGenerationsPerSecond
+                << ", \"change\": " << r.change
+                << ", \"regression\": " << (r.regression ? "true" : "false");
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+/*
+ * Just enough of a JSON reader to get each result's name and generations per
+ * second back out of a report written by writeReport (or edited by hand).
+ */
+class BaselineReader {
+public:
+    explicit BaselineReader(const std::string& text) :
+        text(text), pos(0) {
+    }
+
+    std::map<std::string, double> read() {
+        std::map<std::string, double> rates;
+        readValue(rates, "", "");
+        return rates;
+    }
+
+private:
+    // Reads one value. Inside a result object, remembers the name and rate it
+    // sees in currentName/currentRate and records them when the object ends.
+    void readValue(std::map<std::string, double>& rates, const std::string& key, const std::string& parentKey) {
+        skipSpace();
+        if (pos >= text.size()) fail();
+        char ch = text[pos];
+        if (ch == '{') {
+            pos++;
+            std::string name;
+            double rate = -1;
+            skipSpace();
+            if (peek() == '}') {
+                pos++;
+                return;
+            }
+            while (true) {
+                skipSpace();
+                std::string member = readString();
+                skipSpace();
+                expect(':');
+                skipSpace();
+                if (member == "name" && peek() == '"') {
+                    name = readString();
+                }
+                else if (member == "generations_per_second" && peek() != '"') {
+                    rate = readNumber();
+                }
+                else {
+                    readValue(rates, member, key);
+                }
+                skipSpace();
+                if (peek() == ',') {
+                    pos++;
+                    continue;
+                }
+                expect('}');
+                break;
+            }
+            if (parentKey == "results" && !name.empty() && rate >= 0) {
+                rates[name] = rate;
+            }
+        }
+        else if (ch == '[') {
+            pos++;
+            skipSpace();
+            if (peek() == ']') {
+                pos++;
+                return;
+            }
+            while (true) {
+                readValue(rates, key, key);
+                skipSpace();
+                if (peek() == ',') {
+                    pos++;
+                    continue;
+                }
+                expect(']');
+                break;
+            }
+        }
+        else if (ch == '"') {
+            readString();
+        }
+        else if (text.compare(pos, 4, "true") == 0 || text.compare(pos, 4, "null") == 0) {
+            pos += 4;
+        }
+        else if (text.compare(pos, 5, "false") == 0) {
+            pos += 5;
+        }
+        else {
+            readNumber();
+        }
+    }
+
+    std::string readString() {
+        expect('"');
+        std::string result;
+        while (pos < text.size() && text[pos] != '"') {
+            if (text[pos] == '\\' && pos + 1 < text.size()) {
+                pos++;
+                if (text[pos] == 'u') {
+                    pos += 4; // control characters never appear in names we compare
+                    pos++;
+                    continue;
+                }
+            }
+            result += text[pos++];
+        }
+        expect('"');
+        return result;
+    }
+
+    double readNumber() {
+        size_t length = 0;
+        double value = std::stod(text.substr(pos, 32), &length);
+        pos += length;
+        return value;
+    }
+
+    void skipSpace() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+    }
+
+    char peek() const {
+        return pos < text.size() ? text[pos] : '\0';
+    }
+
+    void expect(char ch) {
+        if (peek() != ch) fail();
+        pos++;
+    }
+
+    void fail() const {
+        throw std::runtime_error("baseline: malformed JSON near offset " + std::to_string(pos));
+    }
+
+    const std::string& text;
+    size_t pos;
+};
+
+std::map<std::string, double> readBaseline(const std::string& filename) {
+    std::ifstream input(filename);
+    if (!input) {
+        throw std::runtime_error("cannot open baseline \"" + filename + "\"");
+    }
+    std::ostringstream contents;
+    contents << input.rdbuf();
+    std::string text = contents.str();
+    return BaselineReader(text).read();
+}
+
+}
+
+int main(int argc, char** argv) {
+    MemoryTracker::setEnabled(true);
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::exception& ex) {
+        std::cerr << "benchmark: " << ex.what() << std::endl;
+        usage(std::cerr);
+        return 1;
+    }
+
+    try {
+        std::map<std::string, double> baseline;
+        if (!options.baseline.empty()) {
+            baseline = readBaseline(options.baseline);
+        }
+
+        std::vector<Workload> workloads;
+        for (const std::string& file : listPatternFiles(options.patternDirectory)) {
+            try {
+                SimulationGrid grid;
+                readPatternFile(file, grid); // so that one bad file does not stop the whole run
+            }
+            catch (const std::exception& ex) {
+                std::cerr << "benchmark: skipping " << file << ": " << ex.what() << std::endl;
+                continue;
+            }
+            std::string name = file.substr(file.find_last_of("/\\") + 1);
+            workloads.push_back({ name, file, 0, 0 });
+        }
+        for (int size : options.sizes) {
+            for (int density : options.densities) {
+                workloads.push_back({ "soup-" + std::to_string(density) + "%", "", size, density });
+            }
+        }
+
+        std::vector<Result> results;
+        int regressions = 0;
+        std::string countersError;
+        for (const std::string& engineName : options.engines) {
+            std::unique_ptr<PerfCounters> counters;
+            if (options.counters) {
+                counters.reset(new PerfCounters()); // before the engine, so its threads inherit the counters
+                if (countersError.empty() && !counters->getError().empty()) {
+                    countersError = counters->getError();
+                    std::cerr << "hardware counters: " << countersError << std::endl;
+                }
+            }
+            std::unique_ptr<LifeEngine> engine(LifeEngine::create(engineName, options.threads));
+            for (const Workload& workload : workloads) {
+                Result result = runCase(*engine, workload, options, counters.get());
+                auto previous = baseline.find(result.name);
+                if (previous != baseline.end() && previous->second > 0) {
+                    result.baselineGenerationsPerSecond = previous->second;
+                    result.change = result.generationsPerSecond / previous->second - 1;
+                    result.regression = result.change < -options.threshold;
+                    if (result.regression) regressions++;
+                }
+                std::cerr << result.name << ": " << result.generationsPerSecond << " gen/s"
+                          << (result.regression ? "  REGRESSION" : "") << std::endl;
+                results.push_back(result);
+            }
+            engine.reset(); // before the counters it was counted by
+        }
+
+        if (options.output.empty()) {
+            writeReport(std::cout, results, !baseline.empty(), countersError);
+        }
+        else {
+            std::ofstream output(options.output);
+            if (!output) {
+                throw std::runtime_error("cannot write \"" + options.output + "\"");
+            }
+            writeReport(output, results, !baseline.empty(), countersError);
+        }
+        if (regressions > 0) {
+            std::cerr << regressions << " case(s) more than " << options.threshold * 100
+                      << "% slower than the baseline" << std::endl;
+            return 2;
+        }
+    }
+    catch (const std::exception& ex) {
+        std::cerr << "benchmark: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
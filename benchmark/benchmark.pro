@@ -0,0 +1,16 @@
+# Engine benchmark suite with no Qt or Stanford library dependency.
+# Build with: qmake benchmark.pro && make
+# See benchmark.cpp for usage.
+
+TEMPLATE = app
+TARGET = benchmark
+CONFIG += console c++14
+CONFIG -= qt app_bundle
+
+QMAKE_CXXFLAGS += -Wall -Wextra
+
+include($$PWD/../src/core/lifecore.pri)
+
+win32: LIBS += -lpsapi
+
+SOURCES += benchmark.cpp
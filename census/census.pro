@@ -0,0 +1,14 @@
+# Soup search (census) tool with no Qt or Stanford library dependency.
+# Build with: qmake census.pro && make
+# See censusmain.cpp for usage.
+
+TEMPLATE = app
+TARGET = census
+CONFIG += console c++14
+CONFIG -= qt app_bundle
+
+QMAKE_CXXFLAGS += -Wall -Wextra
+
+include($$PWD/../src/core/lifecore.pri)
+
+SOURCES += censusmain.cpp  # not census.cpp, whose object would clash with src/core/census.cpp
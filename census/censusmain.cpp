@@ -0,0 +1,174 @@
+/**
+ * File: censusmain.cpp
+ * --------------------
+ * Runs a soup search from the command line: many small random soups, each
+ * run until it settles, with the objects they leave behind counted by kind
+ * (see census.h):
+ *
+ *    census [--soups N] [--size N] [--density PERCENT] [--rule B3/S23]
+ *           [--seed N] [--threads N] [--max-generations N] [--output FILE]
+ *           [--trace FILE]
+ *
+ * Soups are 16 by 16 at density 50% unless --size and --density say
+ * otherwise, and are given up as unstable after --max-generations (20000).
+ * The census is written to FILE (census.txt by default), and a summary with
+ * the throughput and the commonest objects is printed. The same settings
+ * always give the same census, whatever the number of threads. Exits with
+ * status 1 on bad arguments or if the census cannot be written.
+ */
+
+#include <algorithm> // for sort, min
+#include <cstdlib>   // for getenv
+#include <iomanip>   // for setprecision
+#include <iostream>  // for cout, cerr
+#include <stdexcept> // for invalid_argument
+#include <string>    // for string
+#include <utility>   // for pair
+#include <vector>    // for vector
+
+#include "census.h"
+#include "liferule.h"
+#include "tracing.h"
+#include "logger.h"
+
+namespace {
+
+// how many of the commonest objects the summary lists
+const int kSummaryObjects = 10;
+
+struct Options {
+    CensusSettings settings;
+    std::string outputFile = "census.txt";
+    std::string traceFile;
+};
+
+void usage(std::ostream& out) {
+    out << "usage: census [--soups N] [--size N] [--density PERCENT] [--rule B3/S23]" << std::endl
+        << "              [--seed N] [--threads N] [--max-generations N] [--output FILE]" << std::endl
+        << "              [--trace FILE]" << std::endl;
+}
+
+/**
+ * Function: parseOptions
+ * ----------------------
+ * Fills in options from the command line. Throws std::invalid_argument if
+ * an option is unknown, lacks its value or is out of range.
+ */
+Options parseOptions(int argc, char** argv) {
+    Options options;
+    CensusSettings& settings = options.settings;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.size() <= 2 || arg.compare(0, 2, "--") != 0) {
+            throw std::invalid_argument("unexpected argument " + arg);
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("missing value for " + arg);
+        }
+        std::string value = argv[++i];
+        if (arg == "--soups") {
+            settings.numSoups = std::stoll(value);
+        }
+        else if (arg == "--size") {
+            settings.soupSize = std::stoi(value);
+        }
+        else if (arg == "--density") {
+            settings.density = std::stod(value) / 100;
+        }
+        else if (arg == "--rule") {
+            settings.rule = LifeRule::parse(value);
+        }
+        else if (arg == "--seed") {
+            settings.seed = std::stoull(value);
+        }
+        else if (arg == "--threads") {
+            settings.numThreads = std::stoi(value);
+        }
+        else if (arg == "--max-generations") {
+            settings.maxGenerations = std::stoll(value);
+        }
+        else if (arg == "--output") {
+            options.outputFile = value;
+        }
+        else if (arg == "--trace") {
+            options.traceFile = value;
+        }
+        else {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+    if (settings.numSoups < 0) {
+        throw std::invalid_argument("--soups must not be negative");
+    }
+    if (settings.soupSize <= 0) {
+        throw std::invalid_argument("--size must be positive");
+    }
+    if (!(settings.density >= 0 && settings.density <= 1)) {
+        throw std::invalid_argument("--density must be from 0 to 100");
+    }
+    if (settings.maxGenerations < 0) {
+        throw std::invalid_argument("--max-generations must not be negative");
+    }
+    return options;
+}
+
+}
+
+int main(int argc, char** argv) {
+    Logger::setLevel(Logger::parseLevel(std::getenv("LIFE_LOG_LEVEL")));
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::exception& ex) {
+        std::cerr << "census: " << ex.what() << std::endl;
+        usage(std::cerr);
+        return 1;
+    }
+
+    try {
+        const CensusSettings& settings = options.settings;
+        if (!options.traceFile.empty()) {
+            Tracer::setThreadName("main");
+            Tracer::setEnabled(true);
+        }
+        LOG_DEBUG("running " << settings.numSoups << " soups of " << settings.soupSize << "x" << settings.soupSize
+                  << " under " << settings.rule.toString());
+        CensusResult result = runCensus(settings);
+        if (!options.traceFile.empty()) {
+            Tracer::setEnabled(false);
+            if (!Tracer::writeChromeTrace(options.traceFile)) {
+                throw std::runtime_error("cannot write trace \"" + options.traceFile + "\"");
+            }
+        }
+        writeCensus(options.outputFile, settings, result);
+
+        std::vector<std::pair<std::string, long long>> commonest(result.objects.begin(), result.objects.end());
+        std::sort(commonest.begin(), commonest.end(), [](const std::pair<std::string, long long>& a,
+                                                         const std::pair<std::string, long long>& b) {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+        long long objects = 0;
+        for (const std::pair<std::string, long long>& entry : commonest) objects += entry.second;
+
+        std::cout << "rule: " << settings.rule.toString() << std::endl;
+        std::cout << "soups: " << result.soups << " (" << settings.soupSize << "x" << settings.soupSize
+                  << ", seed " << settings.seed << ")" << std::endl;
+        std::cout << "unstable soups: " << result.unstableSoups << std::endl;
+        std::cout << "objects: " << objects << " of " << commonest.size() << " kinds" << std::endl;
+        for (size_t i = 0; i < std::min(commonest.size(), static_cast<size_t>(kSummaryObjects)); i++) {
+            std::cout << "    " << commonest[i].first << " " << commonest[i].second << std::endl;
+        }
+        std::cout << std::fixed << std::setprecision(6) << "seconds: " << result.seconds << std::endl;
+        std::cout << std::setprecision(1)
+                  << "soups per second: " << (result.seconds > 0 ? result.soups / result.seconds : 0) << std::endl
+                  << "generations per second: " << (result.seconds > 0 ? result.generations / result.seconds : 0)
+                  << std::endl;
+        std::cout << "census: " << options.outputFile << std::endl;
+    }
+    catch (const std::exception& ex) {
+        std::cerr << "census: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -204,10 +204,10 @@ PRECOMPILED_HEADER = $$files($$PWD/lib/StanfordCPPLib/private/precompiled.h)
 DISTFILES *= ""
 DISTFILES = ""
 HEADERS *= "" \
-    src/simulationgrid.h
+    src/core/simulationgrid.h
 HEADERS = ""
 SOURCES *= "" \
-    src/simulationgrid.cpp
+    src/core/simulationgrid.cpp
 SOURCES = ""
 
 # include various source .cpp files and header .h files in the build process
@@ -227,6 +227,10 @@ exists($$PWD/src/$$PROJECT_FILTER*.cpp) {
 exists($$PWD/src/test/*.cpp) {
     SOURCES *= $$files($$PWD/src/test/*.cpp)
 }
+
+# simulation core (grid, rules, engines, pattern I/O, history), which has no
+# Qt/SPL dependency; src/core/lifecore.pro builds it as a static library
+include($$PWD/src/core/lifecore.pri)
 exists($$PWD/$$PROJECT_FILTER*.cpp) {
     SOURCES *= $$files($$PWD/$$PROJECT_FILTER*.cpp)
 }
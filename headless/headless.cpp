@@ -0,0 +1,392 @@
+/**
+ * File: headless.cpp
+ * ------------------
+ * Runs the Game of Life from the command line with no window, for batch jobs
+ * and throughput tracking on machines without a display:
+ *
+ *    headless <pattern-file> [--engine simple|parallel] [--rule B3/S23]
+ *             [--generations N] [--threads N] [--trace FILE] [--counters on|off]
+ *             [--save FILE] [--record FILE] [--record-every N]
+ *             [--export FILE] [--export-every N] [--cell-size N] [--palette RRGGBB]
+ *             [--cache DIR] [--cache-size MB]
+ *
+ * The pattern file may be in the plaintext format of res/files, RLE,
+ * macrocell or a binary snapshot; the file's rule is used unless --rule
+ * overrides it, and a snapshot's run carries on from the generation it was
+ * saved at. With --save, the final board is written to FILE: as a snapshot
+ * if its name ends in ".snap", in macrocell format for ".mc" and in the
+ * plaintext format otherwise. With --record, every Nth generation (every one
+ * unless --record-every says otherwise) is appended to a recording in FILE,
+ * which the GUI can play back (see recording.h). With --export, every Nth
+ * generation (every one unless --export-every says otherwise) is drawn, each
+ * cell --cell-size pixels across and coloured by age in shades of the
+ * --palette colour, into a numbered sequence of images named after FILE if
+ * it ends in ".png" or ".ppm", or an animated GIF if it ends in ".gif" (see
+ * frameexport.h). With --cache, results are kept in DIR (created if need
+ * be, and held to --cache-size megabytes, 256 by default), and a run of a
+ * board already run as far before starts from the furthest result kept
+ * instead of simulating again (see resultcache.h); runs that record or
+ * export still simulate every generation, but keep their result.
+ *
+ * Prints the final population, a hash of the final state and how long the
+ * generations took; rates and per-generation figures count only the
+ * generations simulated, not those taken from the cache. With --trace, also
+ * writes a Chrome trace of the run to FILE. With --counters on, also prints
+ * hardware counters per generation where the system provides them (see
+ * perfcounters.h). Heap allocations made while stepping and the bytes still
+ * held afterwards are reported per subsystem (see memorytracker.h). Exits
+ * with status 1 on bad arguments or unreadable input.
+ */
+
+#include <algorithm> // for replace, max
+#include <fstream>   // for ofstream
+#include <iostream>  // for cout, cerr
+#include <iomanip>   // for setprecision, hex
+#include <memory>    // for std::unique_ptr
+#include <string>    // for string
+#include <chrono>    // for steady_clock
+#include <stdexcept> // for invalid_argument
+#include <cstdlib>   // for getenv
+
+#include "simulationgrid.h"
+#include "liferule.h"
+#include "lifeengine.h"
+#include "patternio.h"
+#include "quadtree.h"
+#include "snapshot.h"
+#include "recording.h"
+#include "frameexport.h"
+#include "resultcache.h"
+#include "tracing.h"
+#include "logger.h"
+#include "perfcounters.h"
+#include "memorytracker.h"
+
+namespace {
+
+struct Options {
+    std::string patternFile;
+    std::string engine = "simple";
+    std::string rule; // the pattern file's rule, or B3/S23 if it has none
+    long long generations = 1000;
+    int threads = 0; // one per hardware thread
+    std::string traceFile;
+    bool counters = false;
+    std::string saveFile;
+    std::string recordFile;
+    int recordEvery = 1;
+    std::string exportFile;
+    ExportSettings exportSettings;
+    std::string cacheDirectory;
+    long long cacheBytes = kDefaultCacheBytes;
+};
+
+void usage(std::ostream& out) {
+    out << "usage: headless <pattern-file> [--engine simple|parallel] [--rule B3/S23]" << std::endl
+        << "                [--generations N] [--threads N] [--trace FILE] [--counters on|off]" << std::endl
+        << "                [--save FILE] [--record FILE] [--record-every N]" << std::endl
+        << "                [--export FILE] [--export-every N] [--cell-size N] [--palette RRGGBB]" << std::endl
+        << "                [--cache DIR] [--cache-size MB]" << std::endl;
+}
+
+/**
+ * Function: parseOptions
+ * ----------------------
+ * Fills in options from the command line. Throws std::invalid_argument if
+ * an option is unknown, lacks its value, or no pattern file is given.
+ */
+Options parseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("missing value for " + arg);
+            }
+            std::string value = argv[++i];
+            if (arg == "--engine") {
+                options.engine = value;
+            }
+            else if (arg == "--rule") {
+                options.rule = value;
+            }
+            else if (arg == "--generations") {
+                options.generations = std::stoll(value);
+            }
+            else if (arg == "--threads") {
+                options.threads = std::stoi(value);
+            }
+            else if (arg == "--trace") {
+                options.traceFile = value;
+            }
+            else if (arg == "--counters") {
+                if (value != "on" && value != "off") {
+                    throw std::invalid_argument("--counters must be on or off");
+                }
+                options.counters = value == "on";
+            }
+            else if (arg == "--save") {
+                options.saveFile = value;
+            }
+            else if (arg == "--record") {
+                options.recordFile = value;
+            }
+            else if (arg == "--record-every") {
+                options.recordEvery = std::stoi(value);
+            }
+            else if (arg == "--export") {
+                options.exportFile = value;
+            }
+            else if (arg == "--export-every") {
+                options.exportSettings.interval = std::stoi(value);
+            }
+            else if (arg == "--cell-size") {
+                options.exportSettings.cellSize = std::stoi(value);
+            }
+            else if (arg == "--palette") {
+                if (value.size() != 6 || value.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+                    throw std::invalid_argument("--palette must be six hexadecimal digits");
+                }
+                options.exportSettings.baseColor = static_cast<uint32_t>(std::stoul(value, nullptr, 16));
+            }
+            else if (arg == "--cache") {
+                options.cacheDirectory = value;
+            }
+            else if (arg == "--cache-size") {
+                options.cacheBytes = std::stoll(value) << 20;
+            }
+            else {
+                throw std::invalid_argument("unknown option " + arg);
+            }
+        }
+        else if (options.patternFile.empty()) {
+            options.patternFile = arg;
+        }
+        else {
+            throw std::invalid_argument("more than one pattern file given");
+        }
+    }
+    if (options.patternFile.empty()) {
+        throw std::invalid_argument("no pattern file given");
+    }
+    if (options.generations < 0) {
+        throw std::invalid_argument("--generations must not be negative");
+    }
+    if (options.recordEvery < 1) {
+        throw std::invalid_argument("--record-every must be positive");
+    }
+    if (options.exportSettings.interval < 1) {
+        throw std::invalid_argument("--export-every must be positive");
+    }
+    if (options.exportSettings.cellSize < 1) {
+        throw std::invalid_argument("--cell-size must be positive");
+    }
+    if (options.cacheBytes < 0) {
+        throw std::invalid_argument("--cache-size must not be negative");
+    }
+    return options;
+}
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/**
+ * Function: saveGrid
+ * ------------------
+ * Writes grid to the named file: as a snapshot if the name ends in ".snap",
+ * as a macrocell file for ".mc" and in the plaintext pattern format otherwise.
+ */
+void saveGrid(const std::string& filename, const SimulationGrid& grid, const LifeRule& rule, long long generation) {
+    if (endsWith(filename, ".snap")) {
+        SnapshotInfo info;
+        info.rule = rule;
+        info.generation = generation;
+        writeSnapshot(filename, grid, info);
+        return;
+    }
+    std::ofstream output(filename, std::ios::binary);
+    if (!output) {
+        throw std::runtime_error("cannot write \"" + filename + "\"");
+    }
+    if (endsWith(filename, ".mc")) {
+        Quadtree tree;
+        tree.fromGrid(grid);
+        writeMacrocell(output, tree, rule, generation, grid.getNumRows(), grid.getNumCols());
+    }
+    else {
+        writePattern(output, grid, "generation " + std::to_string(generation) + ", rule " + rule.toString());
+    }
+    if (!output) {
+        throw std::runtime_error("error writing \"" + filename + "\"");
+    }
+}
+
+}
+
+int main(int argc, char** argv) {
+    MemoryTracker::setEnabled(true);
+    Logger::setLevel(Logger::parseLevel(std::getenv("LIFE_LOG_LEVEL")));
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    }
+    catch (const std::exception& ex) {
+        std::cerr << "headless: " << ex.what() << std::endl;
+        usage(std::cerr);
+        return 1;
+    }
+
+    try {
+        LifeRule rule;
+        SimulationGrid grid;
+        long long firstGeneration = 0;
+        if (isSnapshotFile(options.patternFile)) {
+            SnapshotInfo info;
+            readSnapshot(options.patternFile, grid, &info);
+            rule = info.rule;
+            firstGeneration = info.generation;
+        }
+        else {
+            readPatternFile(options.patternFile, grid, &rule);
+        }
+        if (!options.rule.empty()) {
+            rule = LifeRule::parse(options.rule);
+        }
+        // the counters are opened before the engine starts its threads, so that they count those too
+        std::unique_ptr<PerfCounters> counters(options.counters ? new PerfCounters() : nullptr);
+        std::unique_ptr<LifeEngine> engine(LifeEngine::create(options.engine, options.threads));
+        LOG_DEBUG("running " << options.patternFile << " (" << grid.getNumRows() << "x" << grid.getNumCols()
+                  << ") with " << engine->getName() << " for " << options.generations << " generations");
+        SimulationGrid next;
+        if (!options.traceFile.empty()) {
+            Tracer::setThreadName("main");
+            Tracer::setEnabled(true);
+        }
+
+        std::unique_ptr<Recorder> recorder;
+        if (!options.recordFile.empty()) {
+            recorder.reset(new Recorder(options.recordFile, grid.getNumRows(), grid.getNumCols(),
+                                        options.recordEvery));
+            recorder->record(grid, firstGeneration);
+        }
+        std::unique_ptr<FrameExporter> exporter;
+        if (!options.exportFile.empty()) {
+            exporter.reset(new FrameExporter(options.exportFile, grid.getNumRows(), grid.getNumCols(),
+                                             options.exportSettings));
+            exporter->exportFrame(grid, firstGeneration);
+        }
+
+        std::unique_ptr<ResultCache> cache;
+        uint64_t startHash = 0;
+        if (!options.cacheDirectory.empty()) {
+            cache.reset(new ResultCache(options.cacheDirectory, options.cacheBytes));
+            startHash = ResultCache::hashBoard(grid);
+        }
+
+        long long cachedGenerations = 0; // skipped by starting from a cached result
+        if (cache && !recorder && !exporter) {
+            cachedGenerations = std::max(0LL, cache->lookup(startHash, rule, options.generations, grid));
+        }
+        long long simulatedGenerations = options.generations - cachedGenerations;
+
+        // measured over the simulated generations alone, not the cached result's loading
+        MemoryTracker::Snapshot memoryBefore = MemoryTracker::getSnapshot();
+        if (counters) counters->start();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (long long generation = cachedGenerations; generation < options.generations; generation++) {
+            TRACE_SPAN("generation");
+            MEMORY_SCOPE(MemoryTracker::ENGINE);
+            engine->step(grid, next, rule);
+            grid.swap(next);
+            if (recorder) recorder->record(grid, firstGeneration + generation + 1);
+            if (exporter) exporter->exportFrame(grid, firstGeneration + generation + 1);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        PerfCounters::Counts counts = {};
+        if (counters) counts = counters->stop();
+        MemoryTracker::Snapshot memoryAfter = MemoryTracker::getSnapshot();
+        if (cache && simulatedGenerations > 0) {
+            cache->store(startHash, rule, options.generations, grid);
+        }
+        cache.reset();
+        engine.reset();
+        long long recordedFrames = recorder ? recorder->getFrameCount() : 0;
+        recorder.reset(); // waits for the rest of the recording to be written
+        long long exportedFrames = exporter ? exporter->getFrameCount() : 0;
+        exporter.reset(); // waits for the rest of the frames to be encoded
+        if (!options.traceFile.empty()) {
+            Tracer::setEnabled(false);
+            if (!Tracer::writeChromeTrace(options.traceFile)) {
+                throw std::runtime_error("cannot write trace \"" + options.traceFile + "\"");
+            }
+        }
+
+        if (!options.saveFile.empty()) {
+            saveGrid(options.saveFile, grid, rule, firstGeneration + options.generations);
+        }
+
+        double cells = static_cast<double>(grid.getNumRows()) * grid.getNumCols() * simulatedGenerations;
+        std::cout << "pattern: " << options.patternFile << std::endl;
+        std::cout << "size: " << grid.getNumRows() << " x " << grid.getNumCols() << std::endl;
+        std::cout << "engine: " << options.engine << std::endl;
+        std::cout << "rule: " << rule.toString() << std::endl;
+        std::cout << "generations: " << options.generations << std::endl;
+        if (firstGeneration != 0) {
+            std::cout << "final generation: " << firstGeneration + options.generations << std::endl;
+        }
+        if (!options.recordFile.empty()) {
+            std::cout << "recorded frames: " << recordedFrames << " to " << options.recordFile << std::endl;
+        }
+        if (!options.cacheDirectory.empty()) {
+            std::cout << "cached generations: " << cachedGenerations << " of " << options.generations << std::endl;
+        }
+        if (!options.exportFile.empty()) {
+            std::cout << "exported frames: " << exportedFrames << " to " << options.exportFile << std::endl;
+        }
+        std::cout << "population: " << grid.getPopulation() << std::endl;
+        std::cout << "hash: " << std::hex << std::setw(16) << std::setfill('0') << grid.getHash()
+                  << std::dec << std::setfill(' ') << std::endl;
+        std::cout << std::fixed << std::setprecision(6) << "seconds: " << seconds << std::endl;
+        if (simulatedGenerations > 0) {
+            std::cout << std::setprecision(1)
+                      << "generations per second: " << (seconds > 0 ? simulatedGenerations / seconds : 0) << std::endl;
+            std::cout << std::setprecision(3)
+                      << "cells per nanosecond: " << (seconds > 0 ? cells / seconds / 1e9 : 0) << std::endl;
+        }
+        else {
+            std::cout << "generations per second: n/a" << std::endl;
+            std::cout << "cells per nanosecond: n/a" << std::endl;
+        }
+        if (MemoryTracker::isCompiledIn()) {
+            for (int i = 0; i < MemoryTracker::kNumSubsystems; i++) {
+                long long allocations = memoryAfter.usage[i].allocations - memoryBefore.usage[i].allocations;
+                std::cout << "allocations (" << MemoryTracker::getSubsystemName(static_cast<MemoryTracker::Subsystem>(i))
+                          << "): " << allocations << " while stepping, "
+                          << memoryAfter.usage[i].liveBytes << " bytes live" << std::endl;
+            }
+        }
+        if (counters) {
+            if (!counters->getError().empty()) {
+                std::cout << "counters unavailable: " << counters->getError() << std::endl;
+            }
+            for (int i = 0; i < PerfCounters::kNumEvents; i++) {
+                if (!counts.valid[i]) continue;
+                std::string name = PerfCounters::getEventName(static_cast<PerfCounters::Event>(i));
+                std::replace(name.begin(), name.end(), '_', ' ');
+                if (simulatedGenerations > 0) {
+                    std::cout << std::setprecision(1)
+                              << name << " per generation: " << counts.values[i] / simulatedGenerations << std::endl;
+                }
+                else {
+                    std::cout << name << " per generation: n/a" << std::endl;
+                }
+            }
+        }
+    }
+    catch (const std::exception& ex) {
+        std::cerr << "headless: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
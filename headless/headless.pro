@@ -0,0 +1,14 @@
+# Command-line Game of Life runner with no Qt or Stanford library dependency.
+# Build with: qmake headless.pro && make
+# See headless.cpp for usage.
+
+TEMPLATE = app
+TARGET = headless
+CONFIG += console c++14
+CONFIG -= qt app_bundle
+
+QMAKE_CXXFLAGS += -Wall -Wextra
+
+include($$PWD/../src/core/lifecore.pri)
+
+SOURCES += headless.cpp
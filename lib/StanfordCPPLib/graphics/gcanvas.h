@@ -3,6 +3,9 @@
  * ---------------
  *
  * @author Marty Stepp
+ * @version 2026/10/18
+ * - added addAll/removeAll bulk operations
+ * - added bulk setPixelsARGB from a contiguous buffer into a sub-rectangle
  * @version 2018/09/10
  * - added doc comments for new documentation generation
  * @version 2018/09/04
@@ -185,6 +188,14 @@ public:
      */
     virtual void add(GObject& gobj, double x, double y);
 
+    /**
+     * Adds all of the given graphical objects to the canvas.
+     * The canvas is locked once for the whole batch and repainted at most once,
+     * so this is much faster than calling add in a loop for many objects.
+     * @throw ErrorException if any of the objects is null
+     */
+    virtual void addAll(const Vector<GObject*>& gobjs);
+
     /**
      * Removes all graphical objects from the canvas foreground layer
      * and wipes the background layer to show the current background color.
@@ -466,6 +477,14 @@ public:
      */
     virtual void removeAll();
 
+    /**
+     * Removes all of the given graphical objects from the foreground layer
+     * of the canvas, ignoring any that were not present.
+     * The canvas is locked once for the whole batch and repainted at most once.
+     * @throw ErrorException if any of the objects is null
+     */
+    virtual void removeAll(const Vector<GObject*>& gobjs);
+
     /**
      * Removes the click listener from the canvas so that it will no longer
      * call it when events occur.
@@ -685,6 +704,21 @@ public:
      */
     virtual void setPixelsARGB(const Grid<int>& pixelsARGB) Q_DECL_OVERRIDE;
 
+    /**
+     * Copies a rectangle of ARGB pixels from a caller-owned buffer straight
+     * into the background layer, with one memcpy per row instead of one call
+     * per pixel.  The rectangle's top-left corner goes at (x, y).
+     * The buffer holds the rectangle's rows one after another, each
+     * rowStride pixels apart (defaults to width), as 0xAARRGGBB values;
+     * use an alpha of 0xff for opaque colors.
+     * The buffer is not retained after this call returns.
+     * Only the updated region is repainted.
+     * @throw ErrorException if the pixels are null or the rectangle does not
+     *        lie entirely within the canvas
+     */
+    virtual void setPixelsARGB(const unsigned int* pixelsARGB, int x, int y,
+                               int width, int height, int rowStride = 0);
+
     virtual void setWindow(GWindow* window);
 
     /**
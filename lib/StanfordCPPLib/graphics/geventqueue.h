@@ -3,6 +3,9 @@
  * -------------------
  *
  * @author Marty Stepp
+ * @version 2026/10/18
+ * - synchronous GUI-thread calls wait on their own completion instead of polling
+ * - added latency statistics for synchronous GUI-thread calls
  * @version 2018/09/07
  * - added doc comments for new documentation generation
  * @version 2018/08/23
@@ -22,6 +25,7 @@
 #ifndef _geventqueue_h
 #define _geventqueue_h
 
+#include <atomic>
 #include <string>
 #include <QObject>
 #include <QReadWriteLock>
@@ -73,6 +77,26 @@ public:
      */
     GEvent getNextEvent(int mask = ANY_EVENT);
 
+    /**
+     * Returns the average time in milliseconds that synchronous
+     * runOnQtGuiThread calls from other threads have taken, from being
+     * queued until the function finished running on the Qt GUI thread.
+     * Returns 0 if no such calls have been made.
+     */
+    double getSyncCallAverageLatency() const;
+
+    /**
+     * Returns the number of synchronous runOnQtGuiThread calls from other
+     * threads that have completed since the statistics were last reset.
+     */
+    long long getSyncCallCount() const;
+
+    /**
+     * Returns the longest time in milliseconds that any synchronous
+     * runOnQtGuiThread call from another thread has taken.
+     */
+    double getSyncCallMaxLatency() const;
+
     /**
      * Returns true if the given event would be accepted by the current
      * event mask, as per setEventMask.
@@ -80,6 +104,11 @@ public:
     bool isAcceptingEvent(const GEvent& event) const;
     bool isAcceptingEvent(int type) const;
 
+    /**
+     * Sets the synchronous GUI-thread call statistics back to zero.
+     */
+    void resetSyncCallStats();
+
     /**
      * Sets a bit-flagged mask of event types to listen for
      * in the semi-deprecated global event-handling functions like waitForEvent.
@@ -122,6 +151,9 @@ private:
     QReadWriteLock _eventQueueMutex;
     QReadWriteLock _functionQueueMutex;
     int _eventMask;
+    std::atomic<long long> _syncCallCount;
+    std::atomic<long long> _syncCallTotalNanos;
+    std::atomic<long long> _syncCallMaxNanos;
 
     friend class GObservable;
     friend class GThread;
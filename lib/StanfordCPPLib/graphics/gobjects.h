@@ -6,6 +6,9 @@
  * <include src="pictures/ClassHierarchies/GObjectHierarchy-h.html">
  *
  * @author Marty Stepp
+ * @version 2026/10/18
+ * - GCompound keeps a hash set of its contents for O(1) duplicate checks
+ * - added GCompound addAll/removeAll bulk operations
  * @version 2018/09/14
  * - added opacity support
  * - added GCanvas-to-GImage conversion support
@@ -39,6 +42,8 @@
 #define INTERNAL_INCLUDE 1
 #include "gtypes.h"
 #define INTERNAL_INCLUDE 1
+#include "hashset.h"
+#define INTERNAL_INCLUDE 1
 #include "vector.h"
 #undef INTERNAL_INCLUDE
 
@@ -801,6 +806,14 @@ public:
      */
     virtual void add(GObject& gobj, double x, double y);
 
+    /**
+     * Adds every graphical object in the given vector to the compound,
+     * skipping any that are already present.
+     * Unlike calling add in a loop, the compound is repainted at most once.
+     * @throw ErrorException if any of the objects is null
+     */
+    virtual void addAll(const Vector<GObject*>& gobjs);
+
     /**
      * Removes all graphical objects from the compound.
      * Equivalent to removeAll.
@@ -896,6 +909,15 @@ public:
      */
     virtual void removeAll();
 
+    /**
+     * Removes every graphical object in the given vector from the compound,
+     * ignoring any that are not present.
+     * Unlike calling remove in a loop, the contents are scanned only once
+     * and the compound is repainted at most once.
+     * @throw ErrorException if any of the objects is null
+     */
+    virtual void removeAll(const Vector<GObject*>& gobjs);
+
     /**
      * Instructs the compound to redraw all of its graphical objects.
      */
@@ -943,6 +965,7 @@ private:
 
     // instance variables
     Vector<GObject*> _contents;
+    HashSet<GObject*> _contentsSet;   // same objects as _contents, for O(1) lookup
     QWidget* _widget = nullptr;    // widget containing this compound
     bool _autoRepaint;   // automatically repaint on any change; default true
 
@@ -3,6 +3,8 @@
  * ---------------
  *
  * @author Marty Stepp
+ * @version 2026/10/18
+ * - added addAll/removeAll bulk operations for graphical objects
  * @version 2018/10/20
  * - added high-density screen features
  * @version 2018/09/09
@@ -247,6 +249,14 @@ public:
      */
     virtual void add(GObject& obj, double x, double y);
 
+    /**
+     * Adds all of the given graphical objects to the window's canvas
+     * as a single batch, repainting at most once.
+     * This causes the graphical canvas to appear if it was not already showing.
+     * @throw ErrorException if any of the objects is null
+     */
+    virtual void addAll(const Vector<GObject*>& objs);
+
     /**
      * Adds a menu with the given text to the window's top menu bar.
      * If the given menu already exists, returns it without adding it again.
@@ -716,6 +726,13 @@ public:
      */
     virtual void remove(GObject& obj);
 
+    /**
+     * Removes all of the given graphical objects from the canvas of this window
+     * as a single batch, ignoring any that were not present.
+     * @throw ErrorException if any of the objects is null
+     */
+    virtual void removeAll(const Vector<GObject*>& objs);
+
     /**
      * Removes the click listener from this window so that it will no longer
      * call it when events occur.
@@ -8647,6 +8647,10 @@ QSize _Internal_QDoubleSpinBox::sizeHint() const {
  * ---------------------
  *
  * @author Marty Stepp
+ * @version 2026/10/18
+ * - runOnQtGuiThreadSync waits on a per-call future instead of sleep polling
+ * - added latency statistics for synchronous calls
+ * - synchronous waits are recorded as trace spans when tracing is on
  * @version 2018/08/23
  * - renamed to geventqueue.cpp
  * @version 2018/07/03
@@ -8655,8 +8659,12 @@ QSize _Internal_QDoubleSpinBox::sizeHint() const {
 
 #define INTERNAL_INCLUDE 1
 #include "qtgui.h"
+#include <chrono>
+#include <exception>
+#include <future>
 #include <QEvent>
 #include <QThread>
+#include "tracing.h"
 #define INTERNAL_INCLUDE 1
 #include "error.h"
 #define INTERNAL_INCLUDE 1
@@ -8676,7 +8684,10 @@ QSize _Internal_QDoubleSpinBox::sizeHint() const {
 GEventQueue* GEventQueue::_instance = nullptr;
 
 GEventQueue::GEventQueue()
-        : _eventMask(0) {
+        : _eventMask(0),
+          _syncCallCount(0),
+          _syncCallTotalNanos(0),
+          _syncCallMaxNanos(0) {
     // empty
 }
 
@@ -8724,6 +8735,19 @@ GEvent GEventQueue::getNextEvent(int mask) {
     return bogusEvent;
 }
 
+double GEventQueue::getSyncCallAverageLatency() const {
+    long long count = _syncCallCount;
+    return count == 0 ? 0.0 : _syncCallTotalNanos / 1e6 / count;
+}
+
+long long GEventQueue::getSyncCallCount() const {
+    return _syncCallCount;
+}
+
+double GEventQueue::getSyncCallMaxLatency() const {
+    return _syncCallMaxNanos / 1e6;
+}
+
 GEventQueue* GEventQueue::instance() {
     if (!_instance) {
         _instance = new GEventQueue();
@@ -8757,23 +8781,47 @@ void GEventQueue::runOnQtGuiThreadAsync(GThunk thunk) {
     emit eventReady();
 }
 
+void GEventQueue::resetSyncCallStats() {
+    _syncCallCount = 0;
+    _syncCallTotalNanos = 0;
+    _syncCallMaxNanos = 0;
+}
+
 void GEventQueue::runOnQtGuiThreadSync(GThunk thunk) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // the GUI thread signals this call's own promise when the thunk finishes,
+    // so we neither poll nor wait for unrelated thunks queued after ours
+    std::promise<void> done;
+    std::future<void> finished = done.get_future();
+    GThunk signalingThunk = [&thunk, &done]() {
+        try {
+            thunk();
+            done.set_value();
+        } catch (...) {
+            done.set_exception(std::current_exception());
+        }
+    };
+
     _functionQueueMutex.lockForWrite();
-    _functionQueue.add(thunk);
+    _functionQueue.add(signalingThunk);
     _functionQueueMutex.unlock();
     emit eventReady();
+    {
+        TRACE_SPAN("runOnQtGuiThreadSync wait");
+        finished.wait();
+    }
 
-    // TODO: "empty" is not quite right condition
-    while (true) {
-        _functionQueueMutex.lockForRead();
-        bool empty = _functionQueue.isEmpty();
-        _functionQueueMutex.unlock();
-        if (empty) {
-            break;
-        } else {
-            GThread::sleep(1);
-        }
+    long long nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+    _syncCallCount++;
+    _syncCallTotalNanos += nanos;
+    long long maxNanos = _syncCallMaxNanos;
+    while (nanos > maxNanos && !_syncCallMaxNanos.compare_exchange_weak(maxNanos, nanos)) {
+        // retry; maxNanos now holds the latest maximum
     }
+
+    finished.get();   // rethrows anything the thunk threw, on the calling thread
 }
 
 void GEventQueue::setEventMask(int mask) {
@@ -12197,6 +12245,9 @@ QSize GBorderLayout::calculateSize(SizeType sizeType) const {
  * File: gcanvas.cpp
  * -----------------
  *
+ * @version 2026/10/18
+ * - setPixels/setPixelsARGB write whole scanlines instead of calling setPixel
+ * - added bulk sub-rectangle setPixelsARGB from a contiguous buffer
  * @version 2018/09/20
  * - added read/write lock for canvas contents to avoid race conditions
  * @version 2018/09/04
@@ -12209,6 +12260,7 @@ QSize GBorderLayout::calculateSize(SizeType sizeType) const {
 
 #define INTERNAL_INCLUDE 1
 #include "gcanvas.h"
+#include <cstring>
 #define INTERNAL_INCLUDE 1
 #include "gcolor.h"
 #define INTERNAL_INCLUDE 1
@@ -12356,6 +12408,14 @@ void GCanvas::add(GObject& gobj, double x, double y) {
     });
 }
 
+void GCanvas::addAll(const Vector<GObject*>& gobjs) {
+    GThread::runOnQtGuiThread([this, &gobjs]() {
+        lockForWrite();
+        _gcompound.addAll(gobjs);   // calls conditionalRepaint
+        unlock();
+    });
+}
+
 void GCanvas::clear() {
     clearObjects();
     clearPixels();   // calls conditionalRepaint
@@ -12828,6 +12888,14 @@ void GCanvas::removeAll() {
     });
 }
 
+void GCanvas::removeAll(const Vector<GObject*>& gobjs) {
+    GThread::runOnQtGuiThread([this, &gobjs]() {
+        lockForWrite();
+        _gcompound.removeAll(gobjs);
+        unlock();
+    });
+}
+
 void GCanvas::removeClickListener() {
     removeEventListener("click");
 }
@@ -13076,9 +13144,11 @@ void GCanvas::setPixels(const Grid<int>& pixels) {
     }
     GThread::runOnQtGuiThread([this, &pixels]() {
         lockForWrite();
+        int width = pixels.width();
         for (int y = 0; y < pixels.height(); y++) {
-            for (int x = 0; x < pixels.width(); x++) {
-                _backgroundImage->setPixel(x, y, pixels[y][x]);
+            unsigned int* scanLine = reinterpret_cast<unsigned int*>(_backgroundImage->scanLine(y));
+            for (int x = 0; x < width; x++) {
+                scanLine[x] = static_cast<unsigned int>(pixels[y][x]);
             }
         }
         unlock();
@@ -13096,9 +13166,11 @@ void GCanvas::setPixelsARGB(const Grid<int>& pixels) {
 
     GThread::runOnQtGuiThread([this, &pixels]() {
         lockForWrite();
+        int width = pixels.width();
         for (int y = 0; y < pixels.height(); y++) {
-            for (int x = 0; x < pixels.width(); x++) {
-                _backgroundImage->setPixel(x, y, pixels[y][x]);
+            unsigned int* scanLine = reinterpret_cast<unsigned int*>(_backgroundImage->scanLine(y));
+            for (int x = 0; x < width; x++) {
+                scanLine[x] = static_cast<unsigned int>(pixels[y][x]);
             }
         }
         unlock();
@@ -13106,6 +13178,31 @@ void GCanvas::setPixelsARGB(const Grid<int>& pixels) {
     });
 }
 
+void GCanvas::setPixelsARGB(const unsigned int* pixelsARGB, int x, int y,
+                            int width, int height, int rowStride) {
+    require::nonNull(pixelsARGB, "GCanvas::setPixelsARGB", "pixels");
+    if (x < 0 || y < 0 || width < 0 || height < 0
+            || x + width > (int) getWidth() || y + height > (int) getHeight()) {
+        error("GCanvas::setPixelsARGB: rectangle is outside the canvas");
+    }
+    if (rowStride <= 0) {
+        rowStride = width;
+    }
+    ensureBackgroundImage();
+    GThread::runOnQtGuiThread([this, pixelsARGB, x, y, width, height, rowStride]() {
+        lockForWrite();
+        // Format_ARGB32 scanlines are native 0xAARRGGBB words, so rows copy as-is
+        for (int row = 0; row < height; row++) {
+            unsigned int* scanLine = reinterpret_cast<unsigned int*>(_backgroundImage->scanLine(y + row));
+            std::memcpy(scanLine + x,
+                        pixelsARGB + static_cast<size_t>(row) * rowStride,
+                        static_cast<size_t>(width) * sizeof(unsigned int));
+        }
+        unlock();
+        conditionalRepaintRegion(x, y, width, height);
+    });
+}
+
 void GCanvas::setWindow(GWindow *window) {
     _window = window;
 }
@@ -14008,6 +14105,11 @@ void GWindow::add(GObject& obj, double x, double y) {
     _canvas->add(obj, x, y);
 }
 
+void GWindow::addAll(const Vector<GObject*>& objs) {
+    ensureForwardTarget();
+    _canvas->addAll(objs);
+}
+
 QMenu* GWindow::addMenu(const std::string& menu) {
     std::string menuKey = toLowerCase(stringReplace(menu, "&", ""));
     if (_menuMap.containsKey(menuKey)) {
@@ -14513,6 +14615,12 @@ void GWindow::remove(GObject& obj) {
     }
 }
 
+void GWindow::removeAll(const Vector<GObject*>& objs) {
+    if (_canvas) {
+        _canvas->removeAll(objs);   // runs on Qt GUI thread
+    }
+}
+
 void GWindow::remove(GInteractor* interactor) {
     require::nonNull(interactor, "GWindow::remove");
     _contentPane->remove(interactor);
@@ -18092,12 +18200,11 @@ GCompound::GCompound()
 
 void GCompound::add(GObject* gobj) {
     require::nonNull(gobj, "GCompound::add");
-    for (int i = _contents.size() - 1; i >= 0; i--) {   // avoid duplicates
-        if (_contents[i] == gobj) {
-            return;
-        }
+    if (_contentsSet.contains(gobj)) {   // avoid duplicates
+        return;
     }
     _contents.add(gobj);
+    _contentsSet.add(gobj);
     gobj->_parent = this;
     if (gobj->isTransformed()) {
         conditionalRepaint();
@@ -18120,6 +18227,23 @@ void GCompound::add(GObject& gobj, double x, double y) {
     add(&gobj, x, y);
 }
 
+void GCompound::addAll(const Vector<GObject*>& gobjs) {
+    bool added = false;
+    for (GObject* gobj : gobjs) {
+        require::nonNull(gobj, "GCompound::addAll");
+        if (_contentsSet.contains(gobj)) {   // avoid duplicates
+            continue;
+        }
+        _contents.add(gobj);
+        _contentsSet.add(gobj);
+        gobj->_parent = this;
+        added = true;
+    }
+    if (added) {
+        conditionalRepaint();
+    }
+}
+
 void GCompound::clear() {
     removeAll();   // calls conditionalRepaint
 }
@@ -18169,6 +18293,9 @@ void GCompound::draw(QPainter* painter) {
 }
 
 int GCompound::findGObject(GObject* gobj) const {
+    if (!_contentsSet.contains(gobj)) {
+        return -1;
+    }
     int n = _contents.size();
     for (int i = 0; i < n; i++) {
         if (_contents.get(i) == gobj) {
@@ -18247,6 +18374,7 @@ void GCompound::removeAll() {
     bool wasEmpty = _contents.isEmpty();
     Vector<GObject*> contentsCopy = _contents;
     _contents.clear();
+    _contentsSet.clear();
     for (GObject* obj : contentsCopy) {
         obj->_parent = nullptr;
         // TODO: delete obj;
@@ -18256,9 +18384,36 @@ void GCompound::removeAll() {
     }
 }
 
+void GCompound::removeAll(const Vector<GObject*>& gobjs) {
+    HashSet<GObject*> toRemove;
+    for (GObject* gobj : gobjs) {
+        require::nonNull(gobj, "GCompound::removeAll");
+        if (_contentsSet.contains(gobj)) {
+            toRemove.add(gobj);
+        }
+    }
+    if (toRemove.isEmpty()) {
+        return;
+    }
+
+    // single pass over the contents, keeping the z-order of the survivors
+    Vector<GObject*> remaining;
+    for (GObject* obj : _contents) {
+        if (toRemove.contains(obj)) {
+            obj->_parent = nullptr;
+            _contentsSet.remove(obj);
+        } else {
+            remaining.add(obj);
+        }
+    }
+    _contents = remaining;
+    conditionalRepaint();
+}
+
 void GCompound::removeAt(int index) {
     GObject* gobj = _contents[index];
     _contents.remove(index);
+    _contentsSet.remove(gobj);
     gobj->_parent = nullptr;
     if (gobj->isTransformed()) {
         conditionalRepaint();
@@ -19846,6 +20001,8 @@ void GOptionPane::showTextFileDialog(QWidget* /*parent*/,
  * ---------------
  *
  * @author Marty Stepp
+ * @version 2026/10/18
+ * - queued GUI-thread thunks are recorded as trace spans when tracing is on
  * @version 2018/08/23
  * - renamed to qtgui.cpp
  * @version 2018/07/03
@@ -19857,6 +20014,7 @@ void GOptionPane::showTextFileDialog(QWidget* /*parent*/,
 #include <QEvent>
 #include <QtGlobal>
 #include <QThread>
+#include "tracing.h"
 #define INTERNAL_INCLUDE 1
 #include "consoletext.h"
 #define INTERNAL_INCLUDE 1
@@ -19965,6 +20123,12 @@ QtGui* QtGui::instance() {
 void QtGui::processEventFromQueue() {
     if (!GEventQueue::instance()->isEmpty()) {
         GThunk thunk = GEventQueue::instance()->peek();
+        static bool threadNamed = false;
+        if (!threadNamed && Tracer::isEnabled()) {
+            Tracer::setThreadName("Qt GUI");
+            threadNamed = true;
+        }
+        TRACE_SPAN("GEventQueue thunk");
         thunk();
         GEventQueue::instance()->dequeue();
     }
@@ -0,0 +1,66 @@
+/**
+ * File: agepyramid.cpp
+ * --------------------
+ * Implementation of the age mipmap pyramid used for zoomed-out rendering.
+ */
+
+#include <algorithm> // for min
+
+#include "agepyramid.h"
+
+AgePyramid::AgePyramid() :
+    numRows(0), numCols(0) {
+}
+
+void AgePyramid::resize(int numRows, int numCols) {
+    this->numRows = numRows;
+    this->numCols = numCols;
+    levels.clear();
+    int levelRows = numRows;
+    int levelCols = numCols;
+    // keep halving until a single node covers the whole board
+    while (levelRows > 1 || levelCols > 1) {
+        levelRows = (levelRows + 1) / 2;
+        levelCols = (levelCols + 1) / 2;
+        Level level;
+        level.numRows = levelRows;
+        level.numCols = levelCols;
+        level.liveCounts.assign(static_cast<size_t>(levelRows) * levelCols, 0);
+        level.ageSums.assign(static_cast<size_t>(levelRows) * levelCols, 0);
+        levels.push_back(level);
+    }
+}
+
+void AgePyramid::update(int row, int col, int oldAge, int newAge) {
+    int liveDelta = (newAge != 0 ? 1 : 0) - (oldAge != 0 ? 1 : 0);
+    long long ageDelta = newAge - oldAge;
+    if (liveDelta == 0 && ageDelta == 0) return;
+    for (size_t i = 0; i < levels.size(); i++) {
+        row >>= 1;
+        col >>= 1;
+        size_t index = static_cast<size_t>(row) * levels[i].numCols + col;
+        levels[i].liveCounts[index] += liveDelta;
+        levels[i].ageSums[index] += ageDelta;
+    }
+}
+
+int AgePyramid::getMaxLevel() const {
+    return static_cast<int>(levels.size());
+}
+
+int AgePyramid::getLiveCount(int level, int row, int col) const {
+    const Level& l = levels[level - 1];
+    return l.liveCounts[static_cast<size_t>(row) * l.numCols + col];
+}
+
+long long AgePyramid::getAgeSum(int level, int row, int col) const {
+    const Level& l = levels[level - 1];
+    return l.ageSums[static_cast<size_t>(row) * l.numCols + col];
+}
+
+int AgePyramid::getCellCount(int level, int row, int col) const {
+    int size = 1 << level;
+    int height = std::min(size, numRows - row * size);
+    int width = std::min(size, numCols - col * size);
+    return height * width;
+}
@@ -0,0 +1,70 @@
+/**
+ * File: agepyramid.h
+ * ------------------
+ * Defines a mipmap pyramid over the cell ages of a board. Level L of the
+ * pyramid summarises each 2^L x 2^L block of cells by its live-cell count
+ * and the sum of the ages of those live cells, which is all LifeDisplay
+ * needs to shade a single screen pixel when the board is zoomed out far
+ * enough that many cells fall on one pixel.
+ *
+ * Level 0 (individual cells) is not stored; the display keeps its own
+ * ages grid for that.
+ */
+
+#pragma once
+#include <vector> // for std::vector
+
+class AgePyramid {
+public:
+/**
+ * Constructs an empty pyramid; call resize before using it.
+ */
+    AgePyramid();
+
+/**
+ * Discards all levels and builds empty ones for a board of the given size.
+ */
+    void resize(int numRows, int numCols);
+
+/**
+ * Records that the cell at (row, col) changed from oldAge to newAge,
+ * updating one node per level. Ages of 0 mean the cell is dead.
+ */
+    void update(int row, int col, int oldAge, int newAge);
+
+/**
+ * Returns the number of the coarsest level stored, or 0 if the board is
+ * too small to need any levels.
+ */
+    int getMaxLevel() const;
+
+/**
+ * Returns the number of live cells in the block at (row, col) of the given level,
+ * where level >= 1 and row/col are in units of 2^level cells.
+ */
+    int getLiveCount(int level, int row, int col) const;
+
+/**
+ * Returns the sum of the ages of the live cells in the block at (row, col)
+ * of the given level.
+ */
+    long long getAgeSum(int level, int row, int col) const;
+
+/**
+ * Returns how many board cells the block at (row, col) of the given level
+ * covers; blocks on the bottom/right edge may be clipped by the board.
+ */
+    int getCellCount(int level, int row, int col) const;
+
+private:
+    struct Level {
+        int numRows;
+        int numCols;
+        std::vector<int> liveCounts;
+        std::vector<long long> ageSums;
+    };
+
+    int numRows;
+    int numCols;
+    std::vector<Level> levels; // levels[i] holds pyramid level i + 1
+};
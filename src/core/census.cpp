@@ -0,0 +1,621 @@
+/**
+ * File: census.cpp
+ * ----------------
+ * Implementation of soup searches: an unbounded bit-packed plane, object
+ * separation and classification, and the work-stealing scheduler.
+ */
+
+#include <algorithm>     // for min, max, sort, swap
+#include <chrono>        // for steady_clock
+#include <cstdio>        // for rename, remove
+#include <fstream>       // for ofstream
+#include <memory>        // for std::unique_ptr
+#include <mutex>         // for std::mutex
+#include <stdexcept>     // for invalid_argument, runtime_error
+#include <thread>        // for std::thread
+#include <unordered_map> // for std::unordered_map
+
+#include "census.h"
+#include "simulationgrid.h"
+#include "soup.h"
+#include "tracing.h"
+
+namespace {
+
+typedef std::vector<std::pair<int, int>> CellList; // (row, column)
+
+const int kObjectGap = 2;              // live cells this close belong to the same object
+const int kEscapeGap = 24;             // objects this far from all others may be taken out early
+const int kEscapeCheckInterval = 64;   // generations between looks for escaping objects
+const int kCompactExtent = 128;        // soups no bigger than this are not looked at for escapees
+const int kMaxExtent = 4096;           // soups that spread further are unstable
+const int kMaxObjectExtent = 256;      // objects that spread further are not classified
+const int kStabilityCheckInterval = 30; // generations between looks at the population
+const long long kChunkSize = 64;       // soups handed out at a time
+
+int countTrailingZeros(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int count = 0;
+    while ((word & 1) == 0) {
+        word >>= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+int countBits(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    for (; word != 0; word &= word - 1) count++;
+    return count;
+#endif
+}
+
+/*
+ * A plane with no edges, stored as the rectangle of 64-bit words around its
+ * live cells: bit b of word w in row r is column 64w + b. The rectangle
+ * grows whenever live cells come within two words of its sides or two rows of
+ * its top or bottom. Each generation only the words around the live cells
+ * are computed, 64 cells at a time with a bit-sliced neighbour count.
+ */
+class BitPlane {
+public:
+    explicit BitPlane(const LifeRule& rule) :
+        rows(0), words(0), originRow(0), originCol(0), population(0), numCounts(0) {
+        setEmptyBounds();
+        // only the neighbour counts after which some cell is alive need checking
+        for (int n = 0; n <= 8; n++) {
+            if (rule.isBorn(n) || rule.survives(n)) {
+                counts[numCounts] = n;
+                bornAt[numCounts] = rule.isBorn(n);
+                survivesAt[numCounts] = rule.survives(n);
+                numCounts++;
+            }
+        }
+    }
+
+    // row and col are plane coordinates
+    void set(int row, int col) {
+        include(row, col);
+        int r = row - originRow;
+        int c = col - originCol;
+        bits[static_cast<size_t>(r) * words + c / 64] |= 1ULL << (c % 64);
+        population++;
+        top = std::min(top, r);
+        bottom = std::max(bottom, r);
+        firstWord = std::min(firstWord, c / 64);
+        lastWord = std::max(lastWord, c / 64);
+    }
+
+    void erase(const CellList& cells) {
+        for (const std::pair<int, int>& cell : cells) {
+            int r = cell.first - originRow;
+            int c = cell.second - originCol;
+            bits[static_cast<size_t>(r) * words + c / 64] &= ~(1ULL << (c % 64));
+        }
+        findBounds(top, bottom, firstWord, lastWord);
+    }
+
+    void step() {
+        if (population == 0) return;
+        include(originRow + top, originCol + 64 * firstWord);
+        include(originRow + bottom, originCol + 64 * lastWord + 63);
+        int r0 = top - 1, r1 = bottom + 1, w0 = firstWord - 1, w1 = lastWord + 1;
+        // Column by column, so the sums of each row's three cells are worked
+        // out once and reused for the three rows whose neighbours they are.
+        for (int w = w0; w <= w1; w++) {
+            uint64_t upLow, upHigh, midLow, midHigh;
+            rowSums(r0 - 1, w, upLow, upHigh);
+            rowSums(r0, w, midLow, midHigh);
+            for (int r = r0; r <= r1; r++) {
+                uint64_t downLow, downHigh;
+                rowSums(r + 1, w, downLow, downHigh);
+                uint64_t alive = bits[static_cast<size_t>(r) * words + w];
+                // the middle row counts its own cell, so take it back out
+                uint64_t sideLow = midLow ^ alive;
+                uint64_t sideHigh = midHigh ^ (alive & ~midLow);
+                scratch[static_cast<size_t>(r) * words + w] = nextCells(upLow, upHigh, sideLow, sideHigh,
+                                                                        downLow, downHigh, alive);
+                upLow = midLow;
+                upHigh = midHigh;
+                midLow = downLow;
+                midHigh = downHigh;
+            }
+        }
+        std::swap(bits, scratch);
+        // scratch now holds the old generation, all of it inside the old bounds
+        for (int r = top; r <= bottom; r++) {
+            std::fill(&scratch[static_cast<size_t>(r) * words + firstWord],
+                      &scratch[static_cast<size_t>(r) * words + lastWord + 1], 0);
+        }
+        findBounds(r0, r1, w0, w1);
+    }
+
+    long long getPopulation() const {
+        return population;
+    }
+
+    // the larger of the heights and widths of the rectangle of words around the live cells
+    int getExtent() const {
+        if (population == 0) return 0;
+        return std::max(bottom - top + 1, 64 * (lastWord - firstWord + 1));
+    }
+
+    // in plane coordinates, by row and then column
+    CellList getCells() const {
+        CellList cells;
+        if (population == 0) return cells;
+        cells.reserve(static_cast<size_t>(population));
+        for (int r = top; r <= bottom; r++) {
+            for (int w = firstWord; w <= lastWord; w++) {
+                for (uint64_t word = bits[static_cast<size_t>(r) * words + w]; word != 0; word &= word - 1) {
+                    cells.push_back({originRow + r, originCol + 64 * w + countTrailingZeros(word)});
+                }
+            }
+        }
+        return cells;
+    }
+
+private:
+    int rows;
+    int words;
+    int originRow; // plane coordinates of row 0, column 0
+    int originCol;
+    long long population;
+    int top, bottom, firstWord, lastWord; // rows and words holding live cells; top > bottom when there are none
+    std::vector<uint64_t> bits;
+    std::vector<uint64_t> scratch; // all zero outside the generation being computed
+    int numCounts;
+    int counts[9];
+    bool bornAt[9];
+    bool survivesAt[9];
+
+    void setEmptyBounds() {
+        top = firstWord = 1 << 30;
+        bottom = lastWord = -1;
+    }
+
+    // Adds up the three cells of a row around each cell of word w: bit by
+    // bit, low is the sum's ones and high its twos.
+    void rowSums(int r, int w, uint64_t& low, uint64_t& high) const {
+        const uint64_t* row = &bits[static_cast<size_t>(r) * words];
+        uint64_t centre = row[w];
+        uint64_t left = (centre << 1) | (row[w - 1] >> 63);
+        uint64_t right = (centre >> 1) | (row[w + 1] << 63);
+        uint64_t sides = left ^ right;
+        low = sides ^ centre;
+        high = (left & right) | (sides & centre);
+    }
+
+    uint64_t nextCells(uint64_t upLow, uint64_t upHigh, uint64_t sideLow, uint64_t sideHigh,
+                       uint64_t downLow, uint64_t downHigh, uint64_t alive) const {
+        // three two-bit sums into one four-bit neighbour count, c0 to c3
+        uint64_t lows = upLow ^ sideLow;
+        uint64_t c0 = lows ^ downLow;
+        uint64_t carry = (upLow & sideLow) | (lows & downLow);
+        uint64_t highs = upHigh ^ sideHigh;
+        uint64_t twos = highs ^ downHigh;
+        uint64_t fours = (upHigh & sideHigh) | (highs & downHigh);
+        uint64_t c1 = twos ^ carry;
+        uint64_t twosCarry = twos & carry;
+        uint64_t c2 = fours ^ twosCarry;
+        uint64_t c3 = fours & twosCarry;
+        uint64_t result = 0;
+        for (int n = 0; n < numCounts; n++) {
+            int count = counts[n];
+            uint64_t matches = ((count & 1) ? c0 : ~c0) & ((count & 2) ? c1 : ~c1) & ((count & 4) ? c2 : ~c2)
+                             & ((count & 8) ? c3 : ~c3);
+            result |= matches & ((bornAt[n] ? ~alive : 0) | (survivesAt[n] ? alive : 0));
+        }
+        return result;
+    }
+
+    void findBounds(int r0, int r1, int w0, int w1) {
+        setEmptyBounds();
+        population = 0;
+        for (int r = r0; r <= r1; r++) {
+            const uint64_t* row = &bits[static_cast<size_t>(r) * words];
+            for (int w = w0; w <= w1; w++) {
+                if (row[w] == 0) continue;
+                population += countBits(row[w]);
+                top = std::min(top, r);
+                bottom = r;
+                firstWord = std::min(firstWord, w);
+                lastWord = std::max(lastWord, w);
+            }
+        }
+    }
+
+    // Grows the rectangle, if need be, so that the given cell has two rows
+    // and two words of room around it: one for cells to be born into and one
+    // more for computing those.
+    void include(int row, int col) {
+        if (rows == 0) {
+            rows = 16;
+            words = 5;
+            originRow = row - rows / 2;
+            originCol = col - 128;
+            bits.assign(static_cast<size_t>(rows) * words, 0);
+            scratch = bits;
+        }
+        int r = row - originRow;
+        int w = (col - originCol) >= 0 ? (col - originCol) / 64 : -1;
+        int addTop = 0, addBottom = 0, addLeft = 0, addRight = 0;
+        while (r + addTop < 2) addTop += std::max(rows / 2, 2);
+        while (r > rows - 3 + addBottom) addBottom += std::max(rows / 2, 2);
+        while (w + addLeft < 2) addLeft += std::max(words / 2, 1);
+        while (w > words - 3 + addRight) addRight += std::max(words / 2, 1);
+        if (addTop + addBottom + addLeft + addRight == 0) return;
+
+        int newRows = rows + addTop + addBottom;
+        int newWords = words + addLeft + addRight;
+        std::vector<uint64_t> grown(static_cast<size_t>(newRows) * newWords, 0);
+        for (int i = 0; i < rows; i++) {
+            std::copy(&bits[static_cast<size_t>(i) * words], &bits[static_cast<size_t>(i) * words] + words,
+                      &grown[static_cast<size_t>(i + addTop) * newWords + addLeft]);
+        }
+        bits.swap(grown);
+        scratch.assign(bits.size(), 0);
+        rows = newRows;
+        words = newWords;
+        originRow -= addTop;
+        originCol -= 64 * addLeft;
+        if (population > 0) {
+            top += addTop;
+            bottom += addTop;
+            firstWord += addLeft;
+            lastWord += addLeft;
+        }
+    }
+};
+
+struct Bounds {
+    int top, left, bottom, right;
+};
+
+// Splits cells into objects: groups of cells linked by steps of at most kObjectGap.
+std::vector<CellList> separateObjects(const CellList& cells) {
+    std::vector<int> parent(cells.size());
+    for (size_t i = 0; i < cells.size(); i++) parent[i] = static_cast<int>(i);
+    auto find = [&parent](int i) {
+        while (parent[i] != i) i = parent[i] = parent[parent[i]];
+        return i;
+    };
+    std::unordered_map<long long, int> index;
+    auto key = [](int row, int col) {
+        return (static_cast<long long>(row) << 32) ^ static_cast<unsigned int>(col);
+    };
+    for (size_t i = 0; i < cells.size(); i++) index[key(cells[i].first, cells[i].second)] = static_cast<int>(i);
+    for (size_t i = 0; i < cells.size(); i++) {
+        for (int dr = -kObjectGap; dr <= kObjectGap; dr++) {
+            for (int dc = -kObjectGap; dc <= kObjectGap; dc++) {
+                auto other = index.find(key(cells[i].first + dr, cells[i].second + dc));
+                if (other != index.end()) parent[find(static_cast<int>(i))] = find(other->second);
+            }
+        }
+    }
+    std::unordered_map<int, size_t> objectOf;
+    std::vector<CellList> objects;
+    for (size_t i = 0; i < cells.size(); i++) {
+        int root = find(static_cast<int>(i));
+        auto found = objectOf.find(root);
+        if (found == objectOf.end()) {
+            found = objectOf.insert({root, objects.size()}).first;
+            objects.push_back(CellList());
+        }
+        objects[found->second].push_back(cells[i]);
+    }
+    return objects;
+}
+
+Bounds boundsOf(const CellList& cells) {
+    Bounds bounds = { cells[0].first, cells[0].second, cells[0].first, cells[0].second };
+    for (const std::pair<int, int>& cell : cells) {
+        bounds.top = std::min(bounds.top, cell.first);
+        bounds.bottom = std::max(bounds.bottom, cell.first);
+        bounds.left = std::min(bounds.left, cell.second);
+        bounds.right = std::max(bounds.right, cell.second);
+    }
+    return bounds;
+}
+
+// Moves cells so that their bounding box starts at (0, 0), and sorts them.
+CellList normalize(CellList cells) {
+    Bounds bounds = boundsOf(cells);
+    for (std::pair<int, int>& cell : cells) {
+        cell.first -= bounds.top;
+        cell.second -= bounds.left;
+    }
+    std::sort(cells.begin(), cells.end());
+    return cells;
+}
+
+// rows x columns, then each row as a hexadecimal number, leftmost cell lowest
+std::string encode(const CellList& shape) {
+    Bounds bounds = boundsOf(shape);
+    int height = bounds.bottom + 1;
+    int width = bounds.right + 1;
+    int nibbles = (width + 3) / 4;
+    std::vector<std::vector<int>> rows(height, std::vector<int>(nibbles, 0));
+    for (const std::pair<int, int>& cell : shape) {
+        rows[cell.first][cell.second / 4] |= 1 << (cell.second % 4);
+    }
+    const char kDigits[] = "0123456789abcdef";
+    std::string code = std::to_string(height) + "x" + std::to_string(width) + "_";
+    for (int r = 0; r < height; r++) {
+        if (r > 0) code += '.';
+        int n = nibbles - 1;
+        while (n > 0 && rows[r][n] == 0) n--;
+        for (; n >= 0; n--) code += kDigits[rows[r][n]];
+    }
+    return code;
+}
+
+// The smallest encoding of any of the eight rotations and reflections.
+std::string canonicalOrientation(const CellList& shape) {
+    std::string best;
+    for (int transform = 0; transform < 8; transform++) {
+        CellList turned;
+        turned.reserve(shape.size());
+        for (const std::pair<int, int>& cell : shape) {
+            int row = (transform & 1) ? -cell.first : cell.first;
+            int col = (transform & 2) ? -cell.second : cell.second;
+            turned.push_back((transform & 4) ? std::make_pair(col, row) : std::make_pair(row, col));
+        }
+        std::string code = encode(normalize(turned));
+        if (best.empty() || code.size() < best.size() || (code.size() == best.size() && code < best)) {
+            best = code;
+        }
+    }
+    return best;
+}
+
+bool isSettled(const std::vector<long long>& populations) {
+    size_t n = populations.size();
+    for (size_t period = 1; period <= static_cast<size_t>(kMaxCensusPeriod); period++) {
+        size_t window = 4 * period + 16;
+        if (n < window + period) return false;
+        size_t i = n - window;
+        while (i < n && populations[i] == populations[i - period]) i++;
+        if (i == n) return true;
+    }
+    return false;
+}
+
+typedef std::unordered_map<std::string, long long> Tally;
+
+/*
+ * Everything one thread needs to run soups; threads share nothing but the
+ * queues they take soup numbers from.
+ */
+struct SoupRunner {
+    const CensusSettings& settings;
+    Tally objects;
+    long long soups;
+    long long unstableSoups;
+    long long generations;
+
+    explicit SoupRunner(const CensusSettings& settings) :
+        settings(settings), soups(0), unstableSoups(0), generations(0) {
+    }
+
+    void run(long long soup) {
+        SimulationGrid grid;
+        fillRandomSoup(grid, settings.soupSize, settings.soupSize,
+                       settings.seed + 0x9e3779b97f4a7c15ULL * static_cast<uint64_t>(soup + 1), settings.density,
+                       false, 1);
+        BitPlane plane(settings.rule);
+        for (int i = 0; i < settings.soupSize; i++) {
+            for (int j = 0; j < settings.soupSize; j++) {
+                if (grid.getGrid()[i][j] != 0) plane.set(i, j);
+            }
+        }
+        soups++;
+        std::vector<long long> populations;
+        for (long long generation = 0; ; generation++) {
+            populations.push_back(plane.getPopulation());
+            if (generation % kStabilityCheckInterval == 0 && isSettled(populations)) break;
+            if (generation % kEscapeCheckInterval == 0 && plane.getExtent() > kCompactExtent) {
+                if (removeEscapees(plane)) populations.clear(); // the population jumps
+            }
+            if (generation == settings.maxGenerations || plane.getExtent() > kMaxExtent) {
+                unstableSoups++;
+                return;
+            }
+            plane.step();
+            generations++;
+        }
+        for (const CellList& object : separateObjects(plane.getCells())) {
+            objects[classifyObject(object, settings.rule)]++;
+        }
+    }
+
+    // Counts and takes out the spaceships that have left the rest behind.
+    bool removeEscapees(BitPlane& plane) {
+        std::vector<CellList> found = separateObjects(plane.getCells());
+        std::vector<Bounds> bounds;
+        for (const CellList& object : found) bounds.push_back(boundsOf(object));
+        bool removed = false;
+        for (size_t i = 0; i < found.size(); i++) {
+            bool isolated = true;
+            for (size_t j = 0; j < found.size() && isolated; j++) {
+                if (i == j) continue;
+                int rowGap = std::max(bounds[j].top - bounds[i].bottom, bounds[i].top - bounds[j].bottom);
+                int colGap = std::max(bounds[j].left - bounds[i].right, bounds[i].left - bounds[j].right);
+                isolated = std::max(rowGap, colGap) >= kEscapeGap;
+            }
+            if (!isolated) continue;
+            std::string name = classifyObject(found[i], settings.rule);
+            if (name.compare(0, 2, "xq") != 0) continue;
+            objects[name]++;
+            plane.erase(found[i]);
+            removed = true;
+        }
+        return removed;
+    }
+};
+
+/*
+ * Soup numbers are handed out in chunks. Each thread starts with an equal
+ * share of the chunks and works through them from the front; a thread that
+ * runs out takes the back half of whatever another thread has left.
+ */
+struct WorkRange {
+    std::mutex mutex;
+    long long begin; // chunk numbers
+    long long end;
+};
+
+bool takeChunk(std::vector<std::unique_ptr<WorkRange>>& ranges, size_t self, long long& chunk) {
+    {
+        std::lock_guard<std::mutex> lock(ranges[self]->mutex);
+        if (ranges[self]->begin < ranges[self]->end) {
+            chunk = ranges[self]->begin++;
+            return true;
+        }
+    }
+    for (size_t k = 1; k < ranges.size(); k++) {
+        WorkRange& victim = *ranges[(self + k) % ranges.size()];
+        long long begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            long long left = victim.end - victim.begin;
+            if (left <= 0) continue;
+            end = victim.end;
+            begin = end - (left + 1) / 2;
+            victim.end = begin;
+        }
+        chunk = begin;
+        std::lock_guard<std::mutex> lock(ranges[self]->mutex);
+        ranges[self]->begin = begin + 1;
+        ranges[self]->end = end;
+        return true;
+    }
+    return false;
+}
+}
+
+CensusSettings::CensusSettings() :
+    seed(1), numSoups(10000), soupSize(16), density(0.5), maxGenerations(20000), numThreads(0) {
+}
+
+CensusResult::CensusResult() :
+    soups(0), unstableSoups(0), generations(0), seconds(0) {
+}
+
+std::string classifyObject(const CellList& cells, const LifeRule& rule) {
+    BitPlane plane(rule);
+    for (const std::pair<int, int>& cell : cells) plane.set(cell.first, cell.second);
+    long long population = plane.getPopulation();
+    Bounds start = boundsOf(cells);
+    CellList first = normalize(cells);
+    std::vector<CellList> phases(1, first);
+    for (int period = 1; period <= kMaxCensusPeriod; period++) {
+        plane.step();
+        if (plane.getPopulation() == 0 || plane.getExtent() > kMaxObjectExtent) break;
+        CellList now = plane.getCells();
+        CellList shape = normalize(now);
+        if (shape != first) {
+            phases.push_back(shape);
+            continue;
+        }
+        Bounds moved = boundsOf(now);
+        bool still = moved.top == start.top && moved.left == start.left;
+        std::string prefix = !still ? "xq" + std::to_string(period)
+                             : period == 1 ? "xs" + std::to_string(population)
+                             : "xp" + std::to_string(period);
+        std::string best;
+        for (const CellList& phase : phases) {
+            std::string code = canonicalOrientation(phase);
+            if (best.empty() || code.size() < best.size() || (code.size() == best.size() && code < best)) {
+                best = code;
+            }
+        }
+        return prefix + "_" + best;
+    }
+    return "zz_" + std::to_string(population);
+}
+
+CensusResult runCensus(const CensusSettings& settings) {
+    if (settings.numSoups < 0 || settings.soupSize <= 0 || settings.maxGenerations < 0) {
+        throw std::invalid_argument("runCensus: soups, soup size and generations must not be negative");
+    }
+    if (!(settings.density >= 0 && settings.density <= 1)) {
+        throw std::invalid_argument("runCensus: density must be between 0 and 1");
+    }
+    TRACE_SPAN("census");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int numThreads = settings.numThreads > 0 ? settings.numThreads
+                                             : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    long long numChunks = (settings.numSoups + kChunkSize - 1) / kChunkSize;
+    std::vector<std::unique_ptr<WorkRange>> ranges;
+    std::vector<std::unique_ptr<SoupRunner>> runners;
+    for (int t = 0; t < numThreads; t++) {
+        ranges.emplace_back(new WorkRange());
+        ranges.back()->begin = numChunks * t / numThreads;
+        ranges.back()->end = numChunks * (t + 1) / numThreads;
+        runners.emplace_back(new SoupRunner(settings));
+    }
+    auto work = [&](int t) {
+        long long chunk;
+        while (takeChunk(ranges, static_cast<size_t>(t), chunk)) {
+            TRACE_SPAN("soups");
+            long long end = std::min(settings.numSoups, (chunk + 1) * kChunkSize);
+            for (long long soup = chunk * kChunkSize; soup < end; soup++) runners[t]->run(soup);
+        }
+    };
+    std::vector<std::thread> helpers;
+    for (int t = 1; t < numThreads; t++) {
+        helpers.emplace_back([&work, t]() {
+            Tracer::setThreadName("census " + std::to_string(t));
+            work(t);
+        });
+    }
+    work(0);
+    for (std::thread& helper : helpers) helper.join();
+
+    CensusResult result;
+    for (const std::unique_ptr<SoupRunner>& runner : runners) {
+        for (const auto& entry : runner->objects) result.objects[entry.first] += entry.second;
+        result.soups += runner->soups;
+        result.unstableSoups += runner->unstableSoups;
+        result.generations += runner->generations;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void writeCensus(const std::string& filename, const CensusSettings& settings, const CensusResult& result) {
+    std::vector<std::pair<std::string, long long>> sorted(result.objects.begin(), result.objects.end());
+    std::sort(sorted.begin(), sorted.end(), [](const std::pair<std::string, long long>& a,
+                                               const std::pair<std::string, long long>& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    std::string temporary = filename + ".tmp";
+    {
+        std::ofstream output(temporary, std::ios::trunc);
+        output << "# rule " << settings.rule.toString() << ", " << settings.soupSize << "x" << settings.soupSize
+               << " soups at density " << settings.density << ", seed " << settings.seed << '\n'
+               << "# soups " << result.soups << ", unstable " << result.unstableSoups
+               << ", generations " << result.generations << '\n';
+        for (const std::pair<std::string, long long>& entry : sorted) {
+            output << entry.first << ' ' << entry.second << '\n';
+        }
+        if (!output) {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("writeCensus: cannot write \"" + temporary + "\"");
+        }
+    }
+#ifdef _WIN32
+    std::remove(filename.c_str()); // rename does not replace files on Windows
+#endif
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("writeCensus: cannot replace \"" + filename + "\"");
+    }
+}
@@ -0,0 +1,88 @@
+/**
+ * File: census.h
+ * --------------
+ * Defines soup searches: running many small random soups on an unbounded
+ * plane until they settle, and counting the objects left behind (still
+ * lifes, oscillators and spaceships) to characterise a rule.
+ *
+ * Each soup runs until its population has repeated with some period of at
+ * most kMaxCensusPeriod for several periods in a row. The live cells are
+ * then split into objects, cells within two of each other belonging to the
+ * same object, and each object is run on its own to find its period and
+ * whether it moves. Objects that fly far enough away from the rest while the
+ * soup is still settling (escaping gliders, say) are counted and removed
+ * early, so the plane stays small.
+ *
+ * Objects are counted by canonical name, the same whichever phase and
+ * orientation they were found in:
+ *
+ *    xs<population>_<rows>x<columns>_<cells>   still life
+ *    xp<period>_<rows>x<columns>_<cells>       oscillator
+ *    xq<period>_<rows>x<columns>_<cells>       spaceship
+ *    zz_<population>                           did not repeat on its own
+ *
+ * where <cells> lists the rows of the smallest of its phases and
+ * orientations as hexadecimal numbers (leftmost cell in the lowest bit)
+ * separated by '.'. Soups that do not settle within the generation limit,
+ * or spread too far, are counted as unstable and contribute no objects.
+ *
+ * Every soup is generated from the search's seed and its own number (see
+ * soup.h), so a census depends only on its settings, never on the number
+ * of threads that ran it.
+ */
+
+#pragma once
+#include <cstdint> // for uint64_t
+#include <map>     // for std::map
+#include <string>  // for std::string
+#include <utility> // for std::pair
+#include <vector>  // for std::vector
+
+#include "liferule.h"
+
+/**
+ * Longest period looked for, in whole soups and in single objects.
+ */
+const int kMaxCensusPeriod = 60;
+
+struct CensusSettings {
+    LifeRule rule;
+    uint64_t seed;
+    long long numSoups;
+    int soupSize;            // soups are soupSize by soupSize
+    double density;          // chance that a soup cell starts alive
+    long long maxGenerations; // per soup, before it is given up as unstable
+    int numThreads;          // 0 means one per hardware thread
+
+    CensusSettings();
+};
+
+struct CensusResult {
+    std::map<std::string, long long> objects; // count by canonical name
+    long long soups;
+    long long unstableSoups;
+    long long generations;   // simulated, over all soups
+    double seconds;
+
+    CensusResult();
+};
+
+/**
+ * Runs the soups described by settings, spread over threads that steal
+ * work from one another when they run out, and returns the census. Throws
+ * std::invalid_argument if a setting is out of range.
+ */
+CensusResult runCensus(const CensusSettings& settings);
+
+/**
+ * Returns the canonical name (see above) of the object made of the given
+ * live cells, given as row and column pairs, after running it on its own.
+ */
+std::string classifyObject(const std::vector<std::pair<int, int>>& cells, const LifeRule& rule);
+
+/**
+ * Writes a census as text: '#' lines with the settings and totals, then one
+ * line per object name with its count, most common first. Throws
+ * std::runtime_error if the file cannot be written.
+ */
+void writeCensus(const std::string& filename, const CensusSettings& settings, const CensusResult& result);
@@ -0,0 +1,546 @@
+/**
+ * File: frameexport.cpp
+ * ---------------------
+ * Implementation of frame export: the age palette, the PPM, PNG and GIF
+ * encoders and the pool of threads that runs them.
+ */
+
+#include <algorithm> // for min, max
+#include <stdexcept> // for invalid_argument, runtime_error
+
+#include "frameexport.h"
+#include "life-constants.h" // for kMaxAge
+#include "logger.h"
+#include "tracing.h"
+
+namespace {
+
+const int kMaxPrimary = 220; // how light the oldest cells get
+const uint32_t kDeadColor = 0xffffff;
+// exportFrame() waits for the pool once this many bytes of frames are in flight
+const size_t kMaxQueuedBytes = 64 << 20;
+const int kMaxFramesPerThread = 2;
+const int kMaxGifSize = 65535;        // pixels across, in either direction
+const int kGifColorBits = 4;          // a 16-colour palette, enough for every age
+const int kMaxGifCode = 4095;
+const int kDeflateWindow = 32768;
+const int kMinMatch = 3;
+const int kMaxMatch = 258;
+const int kHashBits = 15;
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void putBigEndian32(std::vector<unsigned char>& out, uint32_t value) {
+    for (int i = 3; i >= 0; i--) out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+}
+
+void putLittleEndian16(std::vector<unsigned char>& out, int value) {
+    out.push_back(static_cast<unsigned char>(value));
+    out.push_back(static_cast<unsigned char>(value >> 8));
+}
+
+/*
+ * Calls visit(age) for every pixel of a frame, row by row, each cell a
+ * cellSize by cellSize square.
+ */
+template <typename Visit>
+void forEachPixel(const std::vector<unsigned char>& ages, int numRows, int numCols, int cellSize, Visit visit) {
+    for (int i = 0; i < numRows; i++) {
+        const unsigned char* row = &ages[static_cast<size_t>(i) * numCols];
+        for (int repeat = 0; repeat < cellSize; repeat++) {
+            for (int j = 0; j < numCols; j++) {
+                for (int k = 0; k < cellSize; k++) visit(row[j]);
+            }
+        }
+    }
+}
+
+/*
+ * Writes bits least significant first, as both deflate and GIF want them.
+ */
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<unsigned char>& out) : out(out), buffer(0), count(0) {
+    }
+
+    void put(uint32_t bits, int length) {
+        buffer |= static_cast<uint64_t>(bits) << count;
+        count += length;
+        while (count >= 8) {
+            out.push_back(static_cast<unsigned char>(buffer));
+            buffer >>= 8;
+            count -= 8;
+        }
+    }
+
+    // Huffman codes go most significant bit first
+    void putReversed(uint32_t code, int length) {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; i++) reversed |= ((code >> i) & 1) << (length - 1 - i);
+        put(reversed, length);
+    }
+
+    void flush() {
+        if (count > 0) out.push_back(static_cast<unsigned char>(buffer));
+        buffer = 0;
+        count = 0;
+    }
+
+private:
+    std::vector<unsigned char>& out;
+    uint64_t buffer;
+    int count;
+};
+
+const int kLengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+const int kLengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+const int kDistanceBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+    4097, 6145, 8193, 12289, 16385, 24577
+};
+const int kDistanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// a symbol of deflate's fixed literal/length code
+void putLiteral(BitWriter& bits, int symbol) {
+    if (symbol < 144) bits.putReversed(0x30 + symbol, 8);
+    else if (symbol < 256) bits.putReversed(0x190 + symbol - 144, 9);
+    else if (symbol < 280) bits.putReversed(symbol - 256, 7);
+    else bits.putReversed(0xc0 + symbol - 280, 8);
+}
+
+void putMatch(BitWriter& bits, int length, int distance) {
+    int code = 28;
+    while (kLengthBase[code] > length) code--;
+    putLiteral(bits, 257 + code);
+    bits.put(length - kLengthBase[code], kLengthExtra[code]);
+    code = 29;
+    while (kDistanceBase[code] > distance) code--;
+    bits.putReversed(code, 5);
+    bits.put(distance - kDistanceBase[code], kDistanceExtra[code]);
+}
+
+int matchLength(const unsigned char* data, size_t position, size_t size, size_t distance) {
+    size_t limit = std::min(size - position, static_cast<size_t>(kMaxMatch));
+    size_t length = 0;
+    while (length < limit && data[position + length] == data[position + length - distance]) length++;
+    return static_cast<int>(length);
+}
+
+/*
+ * Compresses data into a zlib stream: one deflate block with the fixed
+ * Huffman codes, and matches found by looking one scanline back (stride),
+ * one byte back, and at the last place the next three bytes were seen.
+ * Frames of cells are mostly long runs and repeated rows, so these few
+ * candidates find nearly all there is to find.
+ */
+void compress(const std::vector<unsigned char>& data, size_t stride, std::vector<unsigned char>& out) {
+    out.push_back(0x78); // deflate, 32K window
+    out.push_back(0x01); // fastest, and a check that makes the header a multiple of 31
+    BitWriter bits(out);
+    bits.put(1, 1); // final block
+    bits.put(1, 2); // fixed codes
+    std::vector<uint32_t> head(1 << kHashBits, 0); // position + 1 of the last three bytes with each hash
+    const unsigned char* bytes = data.data();
+    size_t size = data.size();
+    size_t position = 0;
+    while (position < size) {
+        int bestLength = 0;
+        size_t bestDistance = 0;
+        if (position + kMinMatch <= size) {
+            uint32_t hash = ((bytes[position] << 10) ^ (bytes[position + 1] << 5) ^ bytes[position + 2])
+                          & ((1 << kHashBits) - 1);
+            size_t candidates[3] = { stride, 1, head[hash] != 0 ? position + 1 - head[hash] : 0 };
+            head[hash] = static_cast<uint32_t>(position + 1);
+            for (size_t distance : candidates) {
+                if (distance == 0 || distance > position || distance > static_cast<size_t>(kDeflateWindow)) continue;
+                int length = matchLength(bytes, position, size, distance);
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestDistance = distance;
+                }
+            }
+        }
+        if (bestLength >= kMinMatch) {
+            putMatch(bits, bestLength, static_cast<int>(bestDistance));
+            position += bestLength;
+        }
+        else {
+            putLiteral(bits, bytes[position]);
+            position++;
+        }
+    }
+    putLiteral(bits, 256); // end of block
+    bits.flush();
+
+    uint32_t a = 1, b = 0; // Adler-32 of the uncompressed data
+    for (size_t i = 0; i < size; ) {
+        size_t end = std::min(size, i + 5552); // the most bytes before the sums can overflow
+        for (; i < end; i++) {
+            a += bytes[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    putBigEndian32(out, (b << 16) | a);
+}
+
+struct CrcTable {
+    uint32_t entries[256];
+
+    CrcTable() {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            entries[n] = c;
+        }
+    }
+};
+const CrcTable kCrcTable;
+
+void putPngChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+    putBigEndian32(out, static_cast<uint32_t>(data.size()));
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    uint32_t crc = 0xffffffff;
+    for (size_t i = start; i < out.size(); i++) crc = kCrcTable.entries[(crc ^ out[i]) & 0xff] ^ (crc >> 8);
+    putBigEndian32(out, crc ^ 0xffffffff);
+}
+
+void encodePpm(const std::vector<unsigned char>& ages, int numRows, int numCols, int cellSize,
+               const std::vector<uint32_t>& palette, std::vector<unsigned char>& out) {
+    std::string header = "P6\n" + std::to_string(numCols * cellSize) + " " + std::to_string(numRows * cellSize)
+                       + "\n255\n";
+    out.assign(header.begin(), header.end());
+    out.reserve(out.size() + static_cast<size_t>(numRows) * numCols * cellSize * cellSize * 3);
+    forEachPixel(ages, numRows, numCols, cellSize, [&out, &palette](unsigned char age) {
+        out.push_back(static_cast<unsigned char>(palette[age] >> 16));
+        out.push_back(static_cast<unsigned char>(palette[age] >> 8));
+        out.push_back(static_cast<unsigned char>(palette[age]));
+    });
+}
+
+void encodePng(const std::vector<unsigned char>& ages, int numRows, int numCols, int cellSize,
+               const std::vector<uint32_t>& palette, std::vector<unsigned char>& out) {
+    int width = numCols * cellSize;
+    int height = numRows * cellSize;
+    // each scanline is a filter type (0, none) followed by a palette index per pixel
+    size_t stride = static_cast<size_t>(width) + 1;
+    std::vector<unsigned char> scanlines;
+    scanlines.reserve(stride * height);
+    int column = 0;
+    forEachPixel(ages, numRows, numCols, cellSize, [&scanlines, &column, width](unsigned char age) {
+        if (column == 0) scanlines.push_back(0);
+        scanlines.push_back(age);
+        if (++column == width) column = 0;
+    });
+
+    const unsigned char kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    out.assign(kSignature, kSignature + sizeof(kSignature));
+    std::vector<unsigned char> header;
+    putBigEndian32(header, static_cast<uint32_t>(width));
+    putBigEndian32(header, static_cast<uint32_t>(height));
+    header.push_back(8); // bits per pixel
+    header.push_back(3); // indexed colour
+    header.push_back(0); // deflate
+    header.push_back(0); // standard filters
+    header.push_back(0); // not interlaced
+    putPngChunk(out, "IHDR", header);
+    std::vector<unsigned char> colors;
+    for (uint32_t color : palette) {
+        colors.push_back(static_cast<unsigned char>(color >> 16));
+        colors.push_back(static_cast<unsigned char>(color >> 8));
+        colors.push_back(static_cast<unsigned char>(color));
+    }
+    putPngChunk(out, "PLTE", colors);
+    std::vector<unsigned char> compressed;
+    compress(scanlines, stride, compressed);
+    putPngChunk(out, "IDAT", compressed);
+    putPngChunk(out, "IEND", std::vector<unsigned char>());
+}
+
+/*
+ * Encodes one frame of an animated GIF: its graphic control extension (for
+ * the delay), its image descriptor and its pixels, LZW-compressed and cut
+ * into blocks of at most 255 bytes.
+ */
+void encodeGifFrame(const std::vector<unsigned char>& ages, int numRows, int numCols, int cellSize,
+                    int frameDelay, std::vector<unsigned char>& out) {
+    int width = numCols * cellSize;
+    int height = numRows * cellSize;
+    out.clear();
+    const unsigned char kControl[4] = { 0x21, 0xf9, 4, 0 };
+    out.insert(out.end(), kControl, kControl + 4);
+    putLittleEndian16(out, frameDelay);
+    out.push_back(0); // no transparent colour
+    out.push_back(0);
+    out.push_back(0x2c); // image descriptor
+    putLittleEndian16(out, 0);
+    putLittleEndian16(out, 0);
+    putLittleEndian16(out, width);
+    putLittleEndian16(out, height);
+    out.push_back(0); // the global palette, not interlaced
+    out.push_back(kGifColorBits);
+
+    const int clearCode = 1 << kGifColorBits;
+    const int endCode = clearCode + 1;
+    std::vector<unsigned char> data;
+    BitWriter bits(data);
+    // child[code << kGifColorBits | pixel] is the code for code's string
+    // followed by pixel, or 0 if it has none yet
+    std::vector<uint16_t> child(static_cast<size_t>(kMaxGifCode + 1) << kGifColorBits, 0);
+    int codeSize = kGifColorBits + 1;
+    int maxCode = endCode;
+    int code = -1;
+    bits.put(clearCode, codeSize);
+    forEachPixel(ages, numRows, numCols, cellSize, [&](unsigned char age) {
+        if (code < 0) {
+            code = age;
+            return;
+        }
+        uint16_t& next = child[static_cast<size_t>(code) << kGifColorBits | age];
+        if (next != 0) {
+            code = next;
+            return;
+        }
+        bits.put(code, codeSize);
+        next = static_cast<uint16_t>(++maxCode);
+        if (maxCode >= (1 << codeSize)) codeSize++;
+        if (maxCode == kMaxGifCode) {
+            bits.put(clearCode, codeSize);
+            std::fill(child.begin(), child.end(), 0);
+            codeSize = kGifColorBits + 1;
+            maxCode = endCode;
+        }
+        code = age;
+    });
+    if (code >= 0) bits.put(code, codeSize);
+    bits.put(endCode, codeSize);
+    bits.flush();
+    for (size_t start = 0; start < data.size(); start += 255) {
+        size_t length = std::min<size_t>(255, data.size() - start);
+        out.push_back(static_cast<unsigned char>(length));
+        out.insert(out.end(), data.begin() + start, data.begin() + start + length);
+    }
+    out.push_back(0); // end of the image data
+}
+
+std::vector<unsigned char> gifHeader(int width, int height, const std::vector<uint32_t>& palette) {
+    const char kSignature[6] = { 'G', 'I', 'F', '8', '9', 'a' };
+    std::vector<unsigned char> out(kSignature, kSignature + 6);
+    putLittleEndian16(out, width);
+    putLittleEndian16(out, height);
+    out.push_back(static_cast<unsigned char>(0xf0 | (kGifColorBits - 1))); // a global palette of 2^kGifColorBits
+    out.push_back(0); // background colour
+    out.push_back(0); // square pixels
+    for (int i = 0; i < (1 << kGifColorBits); i++) {
+        uint32_t color = i < static_cast<int>(palette.size()) ? palette[i] : 0;
+        out.push_back(static_cast<unsigned char>(color >> 16));
+        out.push_back(static_cast<unsigned char>(color >> 8));
+        out.push_back(static_cast<unsigned char>(color));
+    }
+    // the Netscape extension, asking for the animation to loop forever
+    const unsigned char kLoop[19] = {
+        0x21, 0xff, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 3, 1, 0, 0, 0
+    };
+    out.insert(out.end(), kLoop, kLoop + sizeof(kLoop));
+    return out;
+}
+}
+
+std::vector<uint32_t> makeAgePalette(uint32_t baseColor) {
+    std::vector<uint32_t> palette(1, kDeadColor);
+    for (int age = 1; age <= kMaxAge; age++) {
+        uint32_t rgb = 0;
+        for (int shift = 16; shift >= 0; shift -= 8) {
+            int base = (baseColor >> shift) & 0xff;
+            int contribution = static_cast<int>(base + static_cast<double>(age) * (kMaxPrimary - base) / kMaxAge);
+            rgb = (rgb << 8) | static_cast<uint32_t>(contribution);
+        }
+        palette.push_back(rgb);
+    }
+    return palette;
+}
+
+ExportSettings::ExportSettings() :
+    baseColor(0x4080c0), cellSize(1), interval(1), frameDelay(4), numThreads(0) {
+}
+
+FrameExporter::FrameExporter(const std::string& path, int numRows, int numCols, const ExportSettings& settings) :
+    path(path), format(PPM), numRows(numRows), numCols(numCols), settings(settings),
+    palette(makeAgePalette(settings.baseColor)), frameCount(0), maxInFlight(1), closed(false), inFlight(0),
+    nextToWrite(0), writing(false), stopping(false), failed(false), animation(nullptr) {
+    if (endsWith(path, ".png")) format = PNG;
+    else if (endsWith(path, ".gif")) format = GIF;
+    else if (!endsWith(path, ".ppm")) {
+        throw std::invalid_argument("FrameExporter: \"" + path + "\" does not end in .png, .ppm or .gif");
+    }
+    if (numRows <= 0 || numCols <= 0 || settings.cellSize <= 0) {
+        throw std::invalid_argument("FrameExporter: bad dimensions");
+    }
+    long long width = static_cast<long long>(numCols) * settings.cellSize;
+    long long height = static_cast<long long>(numRows) * settings.cellSize;
+    if (width > (format == GIF ? kMaxGifSize : 1 << 30) || height > (format == GIF ? kMaxGifSize : 1 << 30)) {
+        throw std::invalid_argument("FrameExporter: images would be too large");
+    }
+    this->settings.interval = std::max(settings.interval, 1);
+    int numThreads = settings.numThreads > 0 ? settings.numThreads
+                                             : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    size_t frameBytes = static_cast<size_t>(numRows) * numCols;
+    maxInFlight = std::max<size_t>(1, std::min<size_t>(static_cast<size_t>(kMaxFramesPerThread) * numThreads,
+                                                        kMaxQueuedBytes / frameBytes));
+    if (format == GIF) {
+        animation = std::fopen(path.c_str(), "wb");
+        if (animation == nullptr) {
+            throw std::runtime_error("FrameExporter: cannot create \"" + path + "\"");
+        }
+        writeBytes(animation, gifHeader(static_cast<int>(width), static_cast<int>(height), palette), path);
+    }
+    for (int t = 0; t < numThreads; t++) threads.emplace_back(&FrameExporter::run, this);
+}
+
+FrameExporter::~FrameExporter() {
+    close();
+}
+
+void FrameExporter::exportFrame(const SimulationGrid& grid, long long generation) {
+    if (closed || generation % settings.interval != 0) return;
+    if (grid.getNumRows() != numRows || grid.getNumCols() != numCols) {
+        throw std::invalid_argument("FrameExporter: board size changed");
+    }
+    Pending pending;
+    pending.frame = frameCount;
+    {
+        TRACE_SPAN("export frame");
+        pending.ages.resize(static_cast<size_t>(numRows) * numCols);
+        unsigned char* out = pending.ages.data();
+        for (int i = 0; i < numRows; i++) {
+            const int* row = grid.getGrid()[i];
+            for (int j = 0; j < numCols; j++) *out++ = static_cast<unsigned char>(std::min(row[j], kMaxAge));
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeup.wait(lock, [this] { return inFlight < maxInFlight; });
+        queue.push_back(std::move(pending));
+        inFlight++;
+    }
+    wakeup.notify_all();
+    frameCount++;
+}
+
+void FrameExporter::close() {
+    if (closed) return;
+    closed = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    for (std::thread& thread : threads) thread.join();
+    if (animation != nullptr) {
+        writeBytes(animation, std::vector<unsigned char>(1, 0x3b), path); // the GIF trailer
+        if (std::fclose(animation) != 0) reportFailure(path);
+        animation = nullptr;
+    }
+    if (!failed) {
+        LOG_INFO("exported " << frameCount << " frames to " << (format == GIF ? path : getFrameFilename(0)));
+    }
+}
+
+long long FrameExporter::getFrameCount() const {
+    return frameCount;
+}
+
+std::string FrameExporter::getFrameFilename(long long frame) const {
+    if (format == GIF) return path;
+    std::string number = std::to_string(frame);
+    if (number.size() < 6) number.insert(0, 6 - number.size(), '0');
+    size_t dot = path.rfind('.');
+    return path.substr(0, dot) + "-" + number + path.substr(dot);
+}
+
+void FrameExporter::run() {
+    Tracer::setThreadName("frame export");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wakeup.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) return; // stopping, and every frame is taken
+        Pending pending = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        writeFrame(pending);
+        lock.lock();
+    }
+}
+
+void FrameExporter::writeFrame(const Pending& pending) {
+    std::vector<unsigned char> bytes;
+    {
+        TRACE_SPAN("encode frame");
+        if (format == PPM) encodePpm(pending.ages, numRows, numCols, settings.cellSize, palette, bytes);
+        else if (format == PNG) encodePng(pending.ages, numRows, numCols, settings.cellSize, palette, bytes);
+        else encodeGifFrame(pending.ages, numRows, numCols, settings.cellSize, settings.frameDelay, bytes);
+    }
+    if (format == GIF) {
+        writeAnimationFrames(pending.frame, std::move(bytes));
+        return;
+    }
+    std::string filename = getFrameFilename(pending.frame);
+    FILE* file = std::fopen(filename.c_str(), "wb");
+    if (file == nullptr) {
+        reportFailure(filename);
+    }
+    else {
+        writeBytes(file, bytes, filename);
+        if (std::fclose(file) != 0) reportFailure(filename);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inFlight--;
+    }
+    wakeup.notify_all(); // exportFrame may be waiting for room
+}
+
+/*
+ * Frames of a GIF can finish encoding in any order. Each is left in encoded
+ * until every frame before it has been written; whichever thread finds the
+ * next frame due writes it, and any that have piled up behind it, while the
+ * others go back to encoding.
+ */
+void FrameExporter::writeAnimationFrames(long long frame, std::vector<unsigned char> bytes) {
+    std::unique_lock<std::mutex> lock(mutex);
+    encoded[frame] = std::move(bytes);
+    if (writing) return; // the writing thread will get to it
+    writing = true;
+    while (!encoded.empty() && encoded.begin()->first == nextToWrite) {
+        std::vector<unsigned char> next = std::move(encoded.begin()->second);
+        encoded.erase(encoded.begin());
+        lock.unlock();
+        writeBytes(animation, next, path);
+        lock.lock();
+        nextToWrite++;
+        inFlight--;
+        wakeup.notify_all();
+    }
+    writing = false;
+}
+
+void FrameExporter::writeBytes(FILE* file, const std::vector<unsigned char>& bytes, const std::string& filename) {
+    if (std::fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size()) reportFailure(filename);
+}
+
+void FrameExporter::reportFailure(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!failed) LOG_ERROR("exporting frames to " << filename << " failed; later frames may be lost");
+    failed = true;
+}
@@ -0,0 +1,136 @@
+/**
+ * File: frameexport.h
+ * -------------------
+ * Defines frame export: turning generations of a run into images, coloured
+ * by age in the same shades as the display, for animations of runs.
+ *
+ * Frames are written either as a numbered sequence of images or as one
+ * animated GIF. For a sequence, the path names the first image and the rest
+ * follow it: exporting to "out/run.png" writes out/run-000000.png,
+ * out/run-000001.png and so on, in PNG or binary PPM ("P6") by the path's
+ * extension. A path ending in ".gif" gets a looping animated GIF.
+ *
+ * Images are indexed-colour where the format allows, with one palette entry
+ * per age (see makeAgePalette), and each cell drawn as a square of
+ * cellSize by cellSize pixels. PNGs are compressed with a small built-in
+ * deflate encoder, so no image library is needed, and nothing here needs a
+ * display.
+ */
+
+#pragma once
+#include <condition_variable> // for std::condition_variable
+#include <cstdint>            // for uint32_t
+#include <cstdio>             // for FILE
+#include <deque>              // for std::deque
+#include <map>                // for std::map
+#include <mutex>              // for std::mutex
+#include <string>             // for std::string
+#include <thread>             // for std::thread
+#include <vector>             // for std::vector
+
+#include "simulationgrid.h"
+
+/**
+ * Returns the colour of each age from 0 to kMaxAge as 0xRRGGBB: white for
+ * dead cells, then shades of baseColor (itself 0xRRGGBB) that grow lighter
+ * with age, each primary moving from its base value towards 220.
+ */
+std::vector<uint32_t> makeAgePalette(uint32_t baseColor);
+
+struct ExportSettings {
+    uint32_t baseColor;  // of the palette, as for makeAgePalette
+    int cellSize;        // pixels across each cell
+    int interval;        // every interval-th generation is exported
+    int frameDelay;      // between animation frames, in hundredths of a second
+    int numThreads;      // encoding threads; 0 means one per hardware thread
+
+    ExportSettings();
+};
+
+/*
+ * Exports frames. exportFrame() only copies the board's ages into a byte
+ * per cell and queues them; a pool of background threads encodes and writes
+ * them while the simulation carries on. Frames of a GIF are encoded in
+ * parallel and written in order. Only a few frames per thread are held at
+ * once: exportFrame() waits for the pool when that many are in flight, so
+ * runs of any length export in bounded memory. All boards must have the
+ * size given to the constructor, and exportFrame() must always be called
+ * from the same thread.
+ */
+class FrameExporter {
+public:
+/**
+ * Prepares to export to path (see above). Throws std::invalid_argument if
+ * the extension is not .png, .ppm or .gif or the images would be too large
+ * for the format, and std::runtime_error if a GIF cannot be created.
+ */
+    FrameExporter(const std::string& path, int numRows, int numCols,
+                  const ExportSettings& settings = ExportSettings());
+
+/**
+ * Calls close.
+ */
+    ~FrameExporter();
+
+/**
+ * Queues the board as the next frame if generation is a multiple of the
+ * interval.
+ */
+    void exportFrame(const SimulationGrid& grid, long long generation);
+
+/**
+ * Waits for every queued frame to be written, and finishes the GIF if
+ * there is one. Later calls to exportFrame are ignored.
+ */
+    void close();
+
+/**
+ * Returns the number of frames queued so far.
+ */
+    long long getFrameCount() const;
+
+/**
+ * Returns the file the given frame is written to.
+ */
+    std::string getFrameFilename(long long frame) const;
+
+private:
+    enum Format { PPM, PNG, GIF };
+
+    struct Pending {
+        long long frame;
+        std::vector<unsigned char> ages; // one byte per cell, row-major, capped at kMaxAge
+    };
+
+    void run();
+    void writeFrame(const Pending& pending);
+    void writeAnimationFrames(long long frame, std::vector<unsigned char> bytes);
+    void writeBytes(FILE* file, const std::vector<unsigned char>& bytes, const std::string& filename);
+    void reportFailure(const std::string& filename);
+
+    std::string path;
+    Format format;
+    int numRows;
+    int numCols;
+    ExportSettings settings;
+    std::vector<uint32_t> palette;
+    long long frameCount;
+    size_t maxInFlight;
+    bool closed;
+
+    std::vector<std::thread> threads;
+    std::mutex mutex; // guards everything below, except the GIF file itself
+    std::condition_variable wakeup;
+    std::deque<Pending> queue;
+    size_t inFlight; // queued, being encoded or waiting for their turn to be written
+    std::map<long long, std::vector<unsigned char>> encoded; // GIF frames waiting for earlier ones
+    long long nextToWrite;
+    bool writing; // a thread is appending GIF frames
+    bool stopping;
+    bool failed;
+
+    FILE* animation; // the GIF, written by one thread at a time
+
+    FrameExporter(const FrameExporter&) = delete;
+    FrameExporter& operator=(const FrameExporter&) = delete;
+};
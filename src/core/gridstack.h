@@ -23,7 +23,7 @@ GridStack<Type>::GridStack() :
 template <class Type>
 void GridStack<Type>::pushGrid(Type t) {
     stack.push_front(t);
-    if (stack.size() > capacity) {
+    if (static_cast<int>(stack.size()) > capacity) {
         delete stack.back();
         stack.pop_back();
     }
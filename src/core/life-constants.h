@@ -0,0 +1,22 @@
+/**
+ * File: life-constants.h
+ * ----------------------
+ * Defines those constants which are shared by the simulation core,
+ * the life-graphics module and the main life module.
+ */
+
+#pragma once
+
+/**
+ * Constants
+ * ---------
+ * Both the graphics module and the main module need to agree
+ * that cells of age kMaxAge and above are equally old--at least
+ * for display purposes.
+ */
+const int kMaxAge = 12;
+const int kSpeedSteps = 100; // speed slider positions; 0 is stopped and kSpeedSteps as fast as possible
+const double kMinGenerationsPerSecond = 0.5; // speed at slider position 1
+const double kMaxGenerationsPerSecond = 5000; // speed at slider position kSpeedSteps - 1
+const double kFrameDelay = 1000.0 / 60; // the display is refreshed at most 60 times per second
+
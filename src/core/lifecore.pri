@@ -0,0 +1,58 @@
+# Simulation core: grid, rules, engines, pattern I/O and catalogue,
+# quadtrees, snapshots and the result cache, random soups and soup censuses,
+# recordings, frame export, undo history, pipeline timing, tracing, logging,
+# hardware counters, allocation tracking and the background simulation
+# worker. Uses only the C++ standard library, so it can be built without Qt
+# or the Stanford library.
+#
+# Projects that want the core compiled in include this file;
+# lifecore.pro builds it on its own as a static library.
+
+INCLUDEPATH *= $$PWD/
+
+SOURCES *= \
+    $$PWD/simulationgrid.cpp \
+    $$PWD/liferule.cpp \
+    $$PWD/lifeengine.cpp \
+    $$PWD/patternio.cpp \
+    $$PWD/patterncatalogue.cpp \
+    $$PWD/mappedfile.cpp \
+    $$PWD/quadtree.cpp \
+    $$PWD/snapshot.cpp \
+    $$PWD/resultcache.cpp \
+    $$PWD/soup.cpp \
+    $$PWD/recording.cpp \
+    $$PWD/frameexport.cpp \
+    $$PWD/census.cpp \
+    $$PWD/simulationworker.cpp \
+    $$PWD/pipelinestats.cpp \
+    $$PWD/tracing.cpp \
+    $$PWD/logger.cpp \
+    $$PWD/perfcounters.cpp \
+    $$PWD/memorytracker.cpp
+
+HEADERS *= \
+    $$PWD/life-constants.h \
+    $$PWD/simulationgrid.h \
+    $$PWD/gridstack.h \
+    $$PWD/triplebuffer.h \
+    $$PWD/liferule.h \
+    $$PWD/lifeengine.h \
+    $$PWD/patternio.h \
+    $$PWD/patterncatalogue.h \
+    $$PWD/mappedfile.h \
+    $$PWD/quadtree.h \
+    $$PWD/snapshot.h \
+    $$PWD/resultcache.h \
+    $$PWD/soup.h \
+    $$PWD/recording.h \
+    $$PWD/frameexport.h \
+    $$PWD/census.h \
+    $$PWD/simulationworker.h \
+    $$PWD/pipelinestats.h \
+    $$PWD/tracing.h \
+    $$PWD/logger.h \
+    $$PWD/perfcounters.h \
+    $$PWD/memorytracker.h
+
+unix: LIBS *= -lpthread
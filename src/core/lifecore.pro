@@ -0,0 +1,11 @@
+# Builds the simulation core as a static library (liblifecore.a / lifecore.lib)
+# for embedding in other programs. Build with: qmake lifecore.pro && make
+
+TEMPLATE = lib
+TARGET = lifecore
+CONFIG += staticlib c++14
+CONFIG -= qt
+
+QMAKE_CXXFLAGS += -Wall -Wextra
+
+include(lifecore.pri)
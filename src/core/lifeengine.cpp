@@ -0,0 +1,173 @@
+/**
+ * File: lifeengine.cpp
+ * --------------------
+ * Implementation of the generation engines.
+ */
+
+#include <algorithm>          // for min
+#include <stdexcept>          // for invalid_argument
+#include <thread>             // for std::thread
+#include <mutex>              // for std::mutex
+#include <condition_variable> // for std::condition_variable
+
+#include "life-constants.h" // for kMaxAge
+#include "lifeengine.h"
+#include "tracing.h"
+#include "memorytracker.h"
+
+namespace {
+
+class SimpleEngine : public LifeEngine {
+public:
+    void step(const SimulationGrid& current, SimulationGrid& next, const LifeRule& rule) override {
+        prepare(current, next);
+        stepRows(current, next, rule, 0, current.getNumRows());
+    }
+
+    std::string getName() const override {
+        return "simple";
+    }
+};
+
+/**
+ * Splits the board into one band of rows per thread. The threads are started
+ * once and then wait for each generation, so a step costs two wakeups rather
+ * than thread creation; the calling thread computes the first band itself.
+ */
+class ParallelEngine : public LifeEngine {
+public:
+    explicit ParallelEngine(int numThreads) :
+        numThreads(numThreads), current(nullptr), next(nullptr), rule(nullptr),
+        jobNumber(0), remaining(0), stopping(false) {
+        for (int i = 1; i < numThreads; i++) {
+            helpers.push_back(std::thread(&ParallelEngine::runHelper, this, i));
+        }
+    }
+
+    ~ParallelEngine() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (std::thread& helper : helpers) {
+            helper.join();
+        }
+    }
+
+    void step(const SimulationGrid& current, SimulationGrid& next, const LifeRule& rule) override {
+        prepare(current, next);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            this->current = &current;
+            this->next = &next;
+            this->rule = &rule;
+            remaining = numThreads - 1;
+            jobNumber++;
+        }
+        jobReady.notify_all();
+        stepBand(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        jobDone.wait(lock, [this] { return remaining == 0; });
+    }
+
+    std::string getName() const override {
+        return "parallel";
+    }
+
+private:
+    void stepBand(int band) {
+        TRACE_SPAN("band");
+        int numRows = current->getNumRows();
+        int firstRow = static_cast<int>(static_cast<long long>(numRows) * band / numThreads);
+        int endRow = static_cast<int>(static_cast<long long>(numRows) * (band + 1) / numThreads);
+        stepRows(*current, *next, *rule, firstRow, endRow);
+    }
+
+    void runHelper(int band) {
+        Tracer::setThreadName("engine helper " + std::to_string(band));
+        MEMORY_SCOPE(MemoryTracker::ENGINE);
+        long long lastJob = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            jobReady.wait(lock, [this, lastJob] { return stopping || jobNumber != lastJob; });
+            if (stopping) return;
+            lastJob = jobNumber;
+            lock.unlock();
+            stepBand(band);
+            lock.lock();
+            if (--remaining == 0) {
+                jobDone.notify_one();
+            }
+        }
+    }
+
+    int numThreads;
+    std::vector<std::thread> helpers;
+    std::mutex mutex; // guards everything below
+    std::condition_variable jobReady;
+    std::condition_variable jobDone;
+    const SimulationGrid* current;
+    SimulationGrid* next;
+    const LifeRule* rule;
+    long long jobNumber;
+    int remaining; // helpers still working on the current job
+    bool stopping;
+};
+
+}
+
+LifeEngine::~LifeEngine() {
+}
+
+LifeEngine* LifeEngine::create(const std::string& name, int numThreads) {
+    if (name == "simple") {
+        return new SimpleEngine();
+    }
+    else if (name == "parallel") {
+        if (numThreads <= 0) {
+            numThreads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        return new ParallelEngine(numThreads);
+    }
+    throw std::invalid_argument("LifeEngine: unknown engine \"" + name + "\"");
+}
+
+std::vector<std::string> LifeEngine::getEngineNames() {
+    return { "simple", "parallel" };
+}
+
+void LifeEngine::prepare(const SimulationGrid& current, SimulationGrid& next) {
+    if (next.getGrid() == nullptr || next.getNumRows() != current.getNumRows()
+            || next.getNumCols() != current.getNumCols()) {
+        next.setGridFieldsEmpty(current.getNumRows(), current.getNumCols());
+    }
+}
+
+void LifeEngine::stepRows(const SimulationGrid& current, SimulationGrid& next, const LifeRule& rule,
+                          int firstRow, int endRow) {
+    int numRows = current.getNumRows();
+    int numCols = current.getNumCols();
+    unsigned int birthMask = rule.getBirthMask();
+    unsigned int survivalMask = rule.getSurvivalMask();
+    for (int i = firstRow; i < endRow; i++) {
+        // the rows above and below, wrapping around the top and bottom edges
+        const int* above = current.getGrid()[(i + numRows - 1) % numRows];
+        const int* row = current.getGrid()[i];
+        const int* below = current.getGrid()[(i + 1) % numRows];
+        int* nextRow = next.getGrid()[i];
+        for (int j = 0; j < numCols; j++) {
+            int left = (j == 0) ? numCols - 1 : j - 1;
+            int right = (j == numCols - 1) ? 0 : j + 1;
+            int neighbours = (above[left] != 0) + (above[j] != 0) + (above[right] != 0)
+                           + (row[left] != 0) + (row[right] != 0)
+                           + (below[left] != 0) + (below[j] != 0) + (below[right] != 0);
+            if (row[j] != 0) {
+                nextRow[j] = ((survivalMask >> neighbours) & 1u) ? std::min(row[j] + 1, kMaxAge) : 0;
+            }
+            else {
+                nextRow[j] = ((birthMask >> neighbours) & 1u) ? 1 : 0;
+            }
+        }
+    }
+}
@@ -0,0 +1,61 @@
+/**
+ * File: lifeengine.h
+ * ------------------
+ * Defines the interface shared by the algorithms that compute the next
+ * generation of a board. The board wraps around at its edges, so cells in
+ * the first and last column (or row) are neighbours.
+ *
+ * Engines are chosen by name so that front ends (the GUI, the headless
+ * runner) can offer every engine without knowing about each one:
+ *
+ *    "simple"   - a single-threaded scan of the whole board
+ *    "parallel" - the same scan split into row bands, one per thread
+ */
+
+#pragma once
+#include <string> // for std::string
+#include <vector> // for std::vector
+
+#include "simulationgrid.h"
+#include "liferule.h"
+
+class LifeEngine {
+public:
+    virtual ~LifeEngine();
+
+/**
+ * Writes the generation after current into next, resizing next if needed.
+ * Cells that stay alive age by one, up to kMaxAge; newborn cells have age 1.
+ * current and next must be different grids.
+ */
+    virtual void step(const SimulationGrid& current, SimulationGrid& next, const LifeRule& rule) = 0;
+
+/**
+ * Returns the name the engine was created with.
+ */
+    virtual std::string getName() const = 0;
+
+/**
+ * Creates the engine with the given name, which the caller then owns.
+ * numThreads only matters to multithreaded engines; 0 means one thread
+ * per hardware thread. Throws std::invalid_argument for unknown names.
+ */
+    static LifeEngine* create(const std::string& name, int numThreads = 0);
+
+/**
+ * Returns the names accepted by create.
+ */
+    static std::vector<std::string> getEngineNames();
+
+protected:
+/**
+ * Makes next the same size as current, keeping its rows if it already is.
+ */
+    static void prepare(const SimulationGrid& current, SimulationGrid& next);
+
+/**
+ * Computes rows [firstRow, endRow) of the next generation.
+ */
+    static void stepRows(const SimulationGrid& current, SimulationGrid& next, const LifeRule& rule,
+                         int firstRow, int endRow);
+};
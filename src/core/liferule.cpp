@@ -0,0 +1,104 @@
+/**
+ * File: liferule.cpp
+ * ------------------
+ * Implementation of B/S rule parsing and formatting.
+ */
+
+#include <cctype>    // for toupper, isdigit
+#include <stdexcept> // for invalid_argument
+
+#include "liferule.h"
+
+namespace {
+// Reads the neighbour counts from text[pos] up to the next '/' or the end
+// into a mask, advancing pos. Counts are single digits 0-8.
+unsigned int readCounts(const std::string& text, size_t& pos) {
+    unsigned int mask = 0;
+    for (; pos < text.size() && text[pos] != '/'; pos++) {
+        char ch = text[pos];
+        if (!std::isdigit(static_cast<unsigned char>(ch)) || ch == '9') {
+            throw std::invalid_argument("LifeRule: bad neighbour count in rule \"" + text + "\"");
+        }
+        mask |= 1u << (ch - '0');
+    }
+    return mask;
+}
+}
+
+LifeRule::LifeRule() :
+    birthMask(1u << 3), survivalMask((1u << 2) | (1u << 3)) {
+}
+
+LifeRule::LifeRule(unsigned int birthMask, unsigned int survivalMask) :
+    birthMask(birthMask), survivalMask(survivalMask) {
+}
+
+LifeRule LifeRule::parse(const std::string& text) {
+    size_t slash = text.find('/');
+    if (slash == std::string::npos || text.find('/', slash + 1) != std::string::npos) {
+        throw std::invalid_argument("LifeRule: expected a rule like B3/S23, got \"" + text + "\"");
+    }
+    size_t pos = 0;
+    if (std::toupper(static_cast<unsigned char>(text[0])) == 'B') {
+        // B<birth>/S<survival>
+        pos = 1;
+        unsigned int birth = readCounts(text, pos);
+        pos++;
+        if (pos >= text.size() || std::toupper(static_cast<unsigned char>(text[pos])) != 'S') {
+            throw std::invalid_argument("LifeRule: expected S after / in rule \"" + text + "\"");
+        }
+        pos++;
+        unsigned int survival = readCounts(text, pos);
+        return LifeRule(birth, survival);
+    }
+    else {
+        // <survival>/<birth>
+        unsigned int survival = readCounts(text, pos);
+        pos++;
+        unsigned int birth = readCounts(text, pos);
+        return LifeRule(birth, survival);
+    }
+}
+
+LifeRule LifeRule::fromMasks(unsigned int birthMask, unsigned int survivalMask) {
+    if ((birthMask | survivalMask) >> 9 != 0) {
+        throw std::invalid_argument("LifeRule: neighbour counts above 8 in masks");
+    }
+    return LifeRule(birthMask, survivalMask);
+}
+
+bool LifeRule::isBorn(int neighbours) const {
+    return (birthMask >> neighbours) & 1u;
+}
+
+bool LifeRule::survives(int neighbours) const {
+    return (survivalMask >> neighbours) & 1u;
+}
+
+unsigned int LifeRule::getBirthMask() const {
+    return birthMask;
+}
+
+unsigned int LifeRule::getSurvivalMask() const {
+    return survivalMask;
+}
+
+std::string LifeRule::toString() const {
+    std::string result = "B";
+    for (int n = 0; n <= 8; n++) {
+        if (isBorn(n)) result += char('0' + n);
+    }
+    result += "/S";
+    for (int n = 0; n <= 8; n++) {
+        if (survives(n)) result += char('0' + n);
+    }
+    return result;
+}
+
+bool LifeRule::operator==(const LifeRule& other) const {
+    return birthMask == other.birthMask && survivalMask == other.survivalMask;
+}
+
+bool LifeRule::operator!=(const LifeRule& other) const {
+    return !(*this == other);
+}
@@ -0,0 +1,57 @@
+/**
+ * File: liferule.h
+ * ----------------
+ * Defines a life-like cellular automaton rule in B/S notation: the numbers
+ * of live neighbours for which a dead cell is born and for which a live cell
+ * survives. The default rule is Conway's, B3/S23.
+ */
+
+#pragma once
+#include <string> // for std::string
+
+class LifeRule {
+public:
+/**
+ * Constructs Conway's rule, B3/S23.
+ */
+    LifeRule();
+
+/**
+ * Parses a rule such as "B3/S23" (either case) or the older survival/birth
+ * form "23/3". Throws std::invalid_argument if the text is not a rule.
+ */
+    static LifeRule parse(const std::string& text);
+
+/**
+ * Builds a rule from masks as returned by getBirthMask and getSurvivalMask.
+ * Throws std::invalid_argument if either has bits above bit 8.
+ */
+    static LifeRule fromMasks(unsigned int birthMask, unsigned int survivalMask);
+
+/**
+ * Returns whether a dead cell with the given number of live neighbours
+ * comes to life, or a live one stays alive.
+ */
+    bool isBorn(int neighbours) const;
+    bool survives(int neighbours) const;
+
+/**
+ * Bit n of a mask is set if the rule applies for n live neighbours.
+ */
+    unsigned int getBirthMask() const;
+    unsigned int getSurvivalMask() const;
+
+/**
+ * Returns the rule in canonical B/S notation, e.g. "B3/S23".
+ */
+    std::string toString() const;
+
+    bool operator==(const LifeRule& other) const;
+    bool operator!=(const LifeRule& other) const;
+
+private:
+    LifeRule(unsigned int birthMask, unsigned int survivalMask);
+
+    unsigned int birthMask;
+    unsigned int survivalMask;
+};
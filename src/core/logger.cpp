@@ -0,0 +1,160 @@
+/**
+ * File: logger.cpp
+ * ----------------
+ * Implementation of the buffered background logger.
+ */
+
+#include <atomic>             // for std::atomic
+#include <cctype>             // for tolower
+#include <chrono>             // for steady_clock
+#include <condition_variable> // for std::condition_variable
+#include <cstdio>             // for FILE, fwrite
+#include <mutex>              // for std::mutex
+#include <thread>             // for std::thread
+#include <vector>             // for std::vector
+
+#include "logger.h"
+
+namespace {
+
+const char* const kLevelNames[] = { "DEBUG", "INFO", "WARNING", "ERROR", "OFF" };
+
+std::atomic<int> currentLevel(Logger::LEVEL_INFO);
+
+// the time that log lines count from: when the program started, not when the first line was logged
+const std::chrono::steady_clock::time_point kStart = std::chrono::steady_clock::now();
+
+/*
+ * The queue of formatted lines and the thread that drains it. Lives in a
+ * function-local static so that it is created on first use and its
+ * destructor writes out whatever is left when the program exits.
+ */
+class LogWriter {
+public:
+    LogWriter() :
+        output(stderr), ownsOutput(false), queued(0), written(0), stopping(false) {
+        thread = std::thread(&LogWriter::run, this);
+    }
+
+    ~LogWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        thread.join();
+        if (ownsOutput) std::fclose(output);
+    }
+
+    void add(Logger::Level level, const std::string& message) {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - kStart).count();
+        char prefix[48];
+        std::snprintf(prefix, sizeof(prefix), "%.6f %s ", seconds, kLevelNames[level]);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending += prefix;
+            pending += message;
+            pending += '\n';
+            queued++;
+        }
+        wakeup.notify_one();
+    }
+
+    bool setFile(const std::string& filename) {
+        FILE* file = std::fopen(filename.c_str(), "a");
+        if (file == nullptr) return false;
+        flush();
+        std::lock_guard<std::mutex> lock(outputMutex);
+        if (ownsOutput) std::fclose(output);
+        output = file;
+        ownsOutput = true;
+        return true;
+    }
+
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex);
+        long long target = queued;
+        wakeup.notify_one();
+        drained.wait(lock, [this, target] { return written >= target; });
+    }
+
+private:
+    void run() {
+        std::string batch;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wakeup.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (pending.empty() && stopping) return;
+            // take everything queued so far and write it with one call, without holding the lock
+            batch.swap(pending);
+            long long batchEnd = queued;
+            lock.unlock();
+            {
+                std::lock_guard<std::mutex> outputLock(outputMutex);
+                std::fwrite(batch.data(), 1, batch.size(), output);
+                std::fflush(output);
+            }
+            batch.clear();
+            lock.lock();
+            written = batchEnd;
+            drained.notify_all();
+        }
+    }
+
+    FILE* output;          // guarded by outputMutex
+    bool ownsOutput;
+    std::mutex outputMutex;
+    std::mutex mutex;      // guards everything below
+    std::condition_variable wakeup;
+    std::condition_variable drained;
+    std::string pending;
+    long long queued;      // lines ever added
+    long long written;     // lines ever written out
+    bool stopping;
+    std::thread thread;
+};
+
+LogWriter& getWriter() {
+    static LogWriter writer;
+    return writer;
+}
+
+}
+
+void Logger::setLevel(Level level) {
+    currentLevel = level;
+}
+
+Logger::Level Logger::getLevel() {
+    return static_cast<Level>(currentLevel.load());
+}
+
+bool Logger::isEnabled(Level level) {
+    return level >= currentLevel.load(std::memory_order_relaxed) && level != LEVEL_OFF;
+}
+
+Logger::Level Logger::parseLevel(const char* text, Level defaultLevel) {
+    if (text == nullptr) return defaultLevel;
+    std::string lower;
+    for (const char* ch = text; *ch != '\0'; ch++) {
+        lower += static_cast<char>(std::tolower(static_cast<unsigned char>(*ch)));
+    }
+    for (int level = LEVEL_DEBUG; level <= LEVEL_OFF; level++) {
+        std::string name = kLevelNames[level];
+        for (char& ch : name) ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        if (lower == name) return static_cast<Level>(level);
+    }
+    return defaultLevel;
+}
+
+bool Logger::setFile(const std::string& filename) {
+    return getWriter().setFile(filename);
+}
+
+void Logger::write(Level level, const std::string& message) {
+    getWriter().add(level, message);
+}
+
+void Logger::flush() {
+    getWriter().flush();
+}
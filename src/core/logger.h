@@ -0,0 +1,81 @@
+/**
+ * File: logger.h
+ * --------------
+ * Defines a levelled logger whose output is written by a background thread,
+ * so that logging from a timer or listener costs a string format and a short
+ * lock rather than a synchronous, flushed write to the console.
+ *
+ * Log through the macros, which skip formatting entirely when the level is
+ * off and take stream-style arguments:
+ *
+ *    LOG_DEBUG("step requested generation=" << frame.generation);
+ *
+ * LOG_DEBUG statements are removed at compile time when LIFE_NO_DEBUG_LOG or
+ * NDEBUG is defined. Each line is written as
+ *
+ *    <seconds since the program started> <LEVEL> <message>
+ *
+ * to standard error (not the Stanford library's console window) unless
+ * setFile chooses a file instead.
+ */
+
+#pragma once
+#include <sstream> // for std::ostringstream
+#include <string>  // for std::string
+
+class Logger {
+public:
+    // prefixed because ERROR and DEBUG are macros on some platforms
+    enum Level { LEVEL_DEBUG, LEVEL_INFO, LEVEL_WARNING, LEVEL_ERROR, LEVEL_OFF };
+
+/**
+ * Sets the least severe level that is written. The default is INFO.
+ */
+    static void setLevel(Level level);
+    static Level getLevel();
+
+/**
+ * Returns whether messages of the given level are currently written.
+ */
+    static bool isEnabled(Level level);
+
+/**
+ * Converts "debug", "info", "warning", "error" or "off" (any case) to a
+ * level; returns defaultLevel for anything else, including nullptr.
+ */
+    static Level parseLevel(const char* text, Level defaultLevel = LEVEL_INFO);
+
+/**
+ * Sends output to the named file (appending) instead of standard error.
+ * Returns false, and keeps the current output, if the file cannot be opened.
+ */
+    static bool setFile(const std::string& filename);
+
+/**
+ * Queues a message for the output thread. Use the macros instead.
+ */
+    static void write(Level level, const std::string& message);
+
+/**
+ * Waits until every message queued so far has been written out.
+ */
+    static void flush();
+};
+
+#define LIFE_LOG(level, message) \
+    do { \
+        if (Logger::isEnabled(level)) { \
+            std::ostringstream logStream_; \
+            logStream_ << message; \
+            Logger::write(level, logStream_.str()); \
+        } \
+    } while (0)
+
+#if defined(LIFE_NO_DEBUG_LOG) || defined(NDEBUG)
+#define LOG_DEBUG(message) do { } while (0)
+#else
+#define LOG_DEBUG(message) LIFE_LOG(Logger::LEVEL_DEBUG, message)
+#endif
+#define LOG_INFO(message) LIFE_LOG(Logger::LEVEL_INFO, message)
+#define LOG_WARNING(message) LIFE_LOG(Logger::LEVEL_WARNING, message)
+#define LOG_ERROR(message) LIFE_LOG(Logger::LEVEL_ERROR, message)
@@ -0,0 +1,78 @@
+/**
+ * File: mappedfile.cpp
+ * --------------------
+ * Implementation of whole-file access with mmap, falling back to reading.
+ */
+
+#include <fstream>   // for ifstream
+#include <sstream>   // for ostringstream
+#include <stdexcept> // for runtime_error
+#ifndef _WIN32
+#include <fcntl.h>    // for open
+#include <sys/mman.h> // for mmap, madvise, munmap
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for close
+#endif
+
+#include "mappedfile.h"
+
+MappedFile::MappedFile(const std::string& filename) :
+    data(nullptr), size(0), mapped(false) {
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("MappedFile: cannot open \"" + filename + "\"");
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* memory = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (memory != MAP_FAILED) {
+            data = static_cast<const char*>(memory);
+            size = static_cast<size_t>(info.st_size);
+            mapped = true;
+        }
+    }
+    close(fd); // the mapping keeps the file open
+    if (mapped) return;
+#endif
+    std::ifstream input(filename, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("MappedFile: cannot open \"" + filename + "\"");
+    }
+    std::ostringstream contents;
+    contents << input.rdbuf();
+    if (input.bad()) {
+        throw std::runtime_error("MappedFile: cannot read \"" + filename + "\"");
+    }
+    buffer = contents.str();
+    data = buffer.data();
+    size = buffer.size();
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (mapped) {
+        munmap(const_cast<char*>(data), size);
+    }
+#endif
+}
+
+const char* MappedFile::getData() const {
+    return data;
+}
+
+size_t MappedFile::getSize() const {
+    return size;
+}
+
+bool MappedFile::isMapped() const {
+    return mapped;
+}
+
+void MappedFile::adviseSequential() {
+#ifndef _WIN32
+    if (mapped) {
+        madvise(const_cast<char*>(data), size, MADV_SEQUENTIAL);
+    }
+#endif
+}
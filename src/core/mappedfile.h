@@ -0,0 +1,48 @@
+/**
+ * File: mappedfile.h
+ * ------------------
+ * Defines read-only access to a whole file as one block of memory. Where
+ * the system allows it the file is memory-mapped, so the bytes are paged in
+ * straight from the page cache as they are read and nothing is copied;
+ * elsewhere (Windows, pipes and other files that cannot be mapped) it is
+ * read into a buffer instead. Either way the bytes stay valid until the
+ * MappedFile is destroyed, which unmaps the file.
+ */
+
+#pragma once
+#include <cstddef> // for size_t
+#include <string>  // for std::string
+
+class MappedFile {
+public:
+/**
+ * Maps or reads the named file. Throws std::runtime_error if it cannot be
+ * opened or read.
+ */
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    const char* getData() const;
+    size_t getSize() const;
+
+/**
+ * Returns whether the bytes are mapped rather than copied into a buffer.
+ */
+    bool isMapped() const;
+
+/**
+ * Tells the system the file will be read once from start to end, so it can
+ * read ahead aggressively and drop pages behind the reader. Does nothing if
+ * the file is not mapped.
+ */
+    void adviseSequential();
+
+private:
+    const char* data;
+    size_t size;
+    bool mapped;
+    std::string buffer; // holds the contents when the file could not be mapped
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+};
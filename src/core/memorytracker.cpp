@@ -0,0 +1,170 @@
+/**
+ * File: memorytracker.cpp
+ * -----------------------
+ * Implementation of the allocation tracker and the global operator new and
+ * delete replacements it relies on.
+ *
+ * Every block is given a small header in front of it recording its size and
+ * the subsystem it was counted against (or that it was not counted), so
+ * delete can take the bytes back off the right total.
+ */
+
+#include <cstdlib> // for malloc, free
+#include <new>     // for bad_alloc, nothrow_t, new_handler
+
+#include "memorytracker.h"
+
+namespace {
+
+struct Totals {
+    std::atomic<long long> allocations;
+    std::atomic<long long> liveBytes;
+};
+
+Totals totals[MemoryTracker::kNumSubsystems]; // zero-initialized before any allocation
+
+thread_local MemoryTracker::Subsystem currentSubsystem = MemoryTracker::OTHER;
+
+const char* const kSubsystemNames[MemoryTracker::kNumSubsystems] = {
+    "other", "engine", "history", "renderer", "scene graph"
+};
+
+}
+
+#ifdef NDEBUG
+std::atomic<bool> MemoryTracker::enabled(false);
+#else
+std::atomic<bool> MemoryTracker::enabled(true);
+#endif
+
+void MemoryTracker::setEnabled(bool enabled) {
+#ifndef LIFE_NO_ALLOCATION_TRACKING
+    MemoryTracker::enabled.store(enabled, std::memory_order_relaxed);
+#else
+    (void) enabled;
+#endif
+}
+
+bool MemoryTracker::isCompiledIn() {
+#ifdef LIFE_NO_ALLOCATION_TRACKING
+    return false;
+#else
+    return true;
+#endif
+}
+
+MemoryTracker::Snapshot MemoryTracker::getSnapshot() {
+    Snapshot snapshot;
+    for (int i = 0; i < kNumSubsystems; i++) {
+        snapshot.usage[i].allocations = totals[i].allocations.load(std::memory_order_relaxed);
+        snapshot.usage[i].liveBytes = totals[i].liveBytes.load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+const char* MemoryTracker::getSubsystemName(Subsystem subsystem) {
+    return kSubsystemNames[subsystem];
+}
+
+MemoryTracker::Subsystem MemoryTracker::setCurrentSubsystem(Subsystem subsystem) {
+    Subsystem previous = currentSubsystem;
+    currentSubsystem = subsystem;
+    return previous;
+}
+
+#ifndef LIFE_NO_ALLOCATION_TRACKING
+
+namespace {
+
+/*
+ * Sits in front of every block. Its size keeps the block after it aligned
+ * for any fundamental type.
+ */
+union Header {
+    struct {
+        std::size_t size;
+        int subsystem; // -1 if the block was not counted
+    } info;
+    long double alignment;
+    void* pointerAlignment;
+    long long integerAlignment;
+};
+
+void* allocate(std::size_t size) {
+    Header* header;
+    while ((header = static_cast<Header*>(std::malloc(sizeof(Header) + size))) == nullptr) {
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) return nullptr;
+        handler();
+    }
+    header->info.size = size;
+    header->info.subsystem = -1;
+    if (MemoryTracker::isEnabled()) {
+        int subsystem = currentSubsystem;
+        header->info.subsystem = subsystem;
+        totals[subsystem].allocations.fetch_add(1, std::memory_order_relaxed);
+        totals[subsystem].liveBytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+    }
+    return header + 1;
+}
+
+void deallocate(void* memory) {
+    if (memory == nullptr) return;
+    Header* header = static_cast<Header*>(memory) - 1;
+    if (header->info.subsystem >= 0) {
+        totals[header->info.subsystem].liveBytes.fetch_sub(static_cast<long long>(header->info.size),
+                                                           std::memory_order_relaxed);
+    }
+    std::free(header);
+}
+
+}
+
+void* operator new(std::size_t size) {
+    void* memory = allocate(size);
+    if (memory == nullptr) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return allocate(size);
+    }
+    catch (...) { // from a new_handler
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* memory) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    deallocate(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    deallocate(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    deallocate(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    deallocate(memory);
+}
+
+#endif // LIFE_NO_ALLOCATION_TRACKING
@@ -0,0 +1,116 @@
+/**
+ * File: memorytracker.h
+ * ---------------------
+ * Defines an allocation tracker that counts heap allocations and live bytes
+ * per subsystem, to show where the hot path allocates and to confirm that
+ * steady-state stepping does not.
+ *
+ * The tracker replaces the global operator new and delete. Code says which
+ * subsystem its allocations belong to with a scope that applies to the
+ * calling thread until it ends:
+ *
+ *    {
+ *        MEMORY_SCOPE(MemoryTracker::HISTORY);
+ *        undoStack.pushGrid(new SimulationGrid(grid));
+ *    }
+ *
+ * Allocations outside any scope count as OTHER. Bytes are returned to the
+ * subsystem that allocated them, whichever thread frees them.
+ *
+ * Counting starts on in debug builds and off when NDEBUG is defined, and can
+ * be switched at run time with setEnabled. While it is off, new and delete
+ * cost one relaxed atomic load more than malloc and free. Blocks allocated
+ * while it was off are never counted, so live bytes cover only what was
+ * allocated since counting began. Defining LIFE_NO_ALLOCATION_TRACKING
+ * leaves the global operators alone and compiles the scopes out.
+ */
+
+#pragma once
+#include <atomic> // for std::atomic
+
+class MemoryTracker {
+public:
+    enum Subsystem {
+        OTHER,       // anything not inside a scope
+        ENGINE,      // computing generations
+        HISTORY,     // the undo stack
+        RENDERER,    // frames handed to the display, and its ages, age pyramid and pixels
+        SCENE_GRAPH, // the Stanford library's graphical objects for the cells
+        kNumSubsystems
+    };
+
+/**
+ * Totals for one subsystem since counting began.
+ */
+    struct Usage {
+        long long allocations;
+        long long liveBytes;
+    };
+
+    struct Snapshot {
+        Usage usage[kNumSubsystems];
+    };
+
+/**
+ * Turns counting on or off. Has no effect if tracking is compiled out.
+ */
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+/**
+ * Returns false if LIFE_NO_ALLOCATION_TRACKING removed the tracker, in
+ * which case every snapshot is all zeroes.
+ */
+    static bool isCompiledIn();
+
+/**
+ * Returns the current totals of every subsystem. Each total is read
+ * atomically, but they are not read at one single instant.
+ */
+    static Snapshot getSnapshot();
+
+/**
+ * Returns a short name for the subsystem, such as "scene graph".
+ */
+    static const char* getSubsystemName(Subsystem subsystem);
+
+/**
+ * Makes the calling thread's allocations count against the given subsystem
+ * and returns the one they counted against before. Use MEMORY_SCOPE.
+ */
+    static Subsystem setCurrentSubsystem(Subsystem subsystem);
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+/*
+ * Attributes the calling thread's allocations to a subsystem for its lifetime.
+ */
+class MemoryScope {
+public:
+    explicit MemoryScope(MemoryTracker::Subsystem subsystem) :
+        previous(MemoryTracker::setCurrentSubsystem(subsystem)) {
+    }
+
+    ~MemoryScope() {
+        MemoryTracker::setCurrentSubsystem(previous);
+    }
+
+private:
+    MemoryTracker::Subsystem previous;
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+};
+
+#define MEMORY_CONCAT_INNER(a, b) a##b
+#define MEMORY_CONCAT(a, b) MEMORY_CONCAT_INNER(a, b)
+#ifdef LIFE_NO_ALLOCATION_TRACKING
+#define MEMORY_SCOPE(subsystem) do { } while (0)
+#else
+#define MEMORY_SCOPE(subsystem) MemoryScope MEMORY_CONCAT(memoryScope, __LINE__)(subsystem)
+#endif
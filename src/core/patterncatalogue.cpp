@@ -0,0 +1,380 @@
+/**
+ * File: patterncatalogue.cpp
+ * --------------------------
+ * Implementation of the pattern catalogue and its index file.
+ */
+
+#include <algorithm> // for min, max
+#include <atomic>    // for std::atomic
+#include <cstdio>    // for rename, remove
+#include <fstream>   // for ifstream, ofstream
+#include <memory>    // for std::unique_ptr
+#include <sstream>   // for istringstream
+#include <stdexcept> // for runtime_error
+#include <thread>    // for std::thread
+#include <sys/stat.h> // for stat
+
+#include "patterncatalogue.h"
+#include "patternio.h"
+#include "mappedfile.h"
+#include "lifeengine.h"
+#include "liferule.h"
+#include "logger.h"
+#include "tracing.h"
+
+namespace {
+
+const char kIndexHeader[] = "LIFECAT";
+const int kNumFields = 17;
+
+bool getFileStamp(const std::string& path, long long& modified, long long& size) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return false;
+    modified = static_cast<long long>(info.st_mtime);
+    size = static_cast<long long>(info.st_size);
+    return true;
+}
+
+uint64_t hashFile(const std::string& path) {
+    MappedFile file(path);
+    file.adviseSequential();
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(file.getData());
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < file.getSize(); i++) {
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/*
+ * The live cells of a board relative to their bounding box, so that a
+ * pattern that has moved compares equal to where it started.
+ */
+struct Shape {
+    long long population;
+    int height;
+    int width;
+    uint64_t hash;
+
+    bool operator==(const Shape& other) const {
+        return population == other.population && height == other.height && width == other.width
+               && hash == other.hash;
+    }
+};
+
+void findBounds(const SimulationGrid& grid, int& top, int& left, int& bottom, int& right) {
+    top = left = bottom = right = -1;
+    for (int i = 0; i < grid.getNumRows(); i++) {
+        const int* row = grid.getGrid()[i];
+        for (int j = 0; j < grid.getNumCols(); j++) {
+            if (row[j] == 0) continue;
+            if (top < 0) {
+                top = bottom = i;
+                left = right = j;
+            }
+            bottom = i;
+            left = std::min(left, j);
+            right = std::max(right, j);
+        }
+    }
+}
+
+Shape shapeOf(const SimulationGrid& grid) {
+    int top, left, bottom, right;
+    findBounds(grid, top, left, bottom, right);
+    Shape shape = { 0, 0, 0, 14695981039346656037ULL };
+    if (top < 0) return shape;
+    shape.height = bottom - top + 1;
+    shape.width = right - left + 1;
+    for (int i = top; i <= bottom; i++) {
+        const int* row = grid.getGrid()[i];
+        for (int j = left; j <= right; j++) {
+            if (row[j] == 0) continue;
+            shape.population++;
+            uint64_t cell = static_cast<uint64_t>(i - top) * shape.width + (j - left);
+            shape.hash = (shape.hash ^ cell) * 1099511628211ULL;
+        }
+    }
+    return shape;
+}
+
+int findPeriod(const SimulationGrid& start, const LifeRule& rule) {
+    if (static_cast<long long>(start.getNumRows()) * start.getNumCols() > kMaxPeriodCells) return 0;
+    Shape first = shapeOf(start);
+    std::unique_ptr<LifeEngine> engine(LifeEngine::create("simple"));
+    SimulationGrid grid(start);
+    SimulationGrid next;
+    for (int period = 1; period <= kMaxPeriod; period++) {
+        engine->step(grid, next, rule);
+        grid.swap(next);
+        if (shapeOf(grid) == first) return period;
+    }
+    return 0;
+}
+
+void makeThumbnail(const SimulationGrid& grid, PatternSummary& summary) {
+    int numRows = grid.getNumRows();
+    int numCols = grid.getNumCols();
+    int scale = std::max(1, (std::max(numRows, numCols) + kThumbnailSize - 1) / kThumbnailSize);
+    summary.thumbnailRows = (numRows + scale - 1) / scale;
+    summary.thumbnailCols = (numCols + scale - 1) / scale;
+    std::vector<int> live(static_cast<size_t>(summary.thumbnailRows) * summary.thumbnailCols, 0);
+    for (int i = 0; i < numRows; i++) {
+        const int* row = grid.getGrid()[i];
+        int* out = live.data() + static_cast<size_t>(i / scale) * summary.thumbnailCols;
+        for (int j = 0; j < numCols; j++) {
+            out[j / scale] += row[j] != 0;
+        }
+    }
+    summary.thumbnail.resize(live.size());
+    for (int r = 0; r < summary.thumbnailRows; r++) {
+        int blockRows = std::min(scale, numRows - r * scale);
+        for (int c = 0; c < summary.thumbnailCols; c++) {
+            int blockCells = blockRows * std::min(scale, numCols - c * scale);
+            size_t pixel = static_cast<size_t>(r) * summary.thumbnailCols + c;
+            summary.thumbnail[pixel] = static_cast<unsigned char>(live[pixel] * 255 / blockCells);
+        }
+    }
+}
+
+// Fields may not contain the index's separators.
+std::string sanitize(const std::string& text) {
+    std::string clean = text;
+    for (char& ch : clean) {
+        if (ch == '\t' || ch == '\n' || ch == '\r') ch = ' ';
+    }
+    return clean;
+}
+
+std::string toHex(const std::vector<unsigned char>& bytes) {
+    const char kDigits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(bytes.size() * 2);
+    for (unsigned char byte : bytes) {
+        hex += kDigits[byte >> 4];
+        hex += kDigits[byte & 0xf];
+    }
+    return hex;
+}
+
+int hexDigit(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    throw std::runtime_error("bad hexadecimal digit");
+}
+
+std::vector<unsigned char> fromHex(const std::string& hex) {
+    if (hex.size() % 2 != 0) throw std::runtime_error("bad thumbnail");
+    std::vector<unsigned char> bytes(hex.size() / 2);
+    for (size_t i = 0; i < bytes.size(); i++) {
+        bytes[i] = static_cast<unsigned char>(hexDigit(hex[2 * i]) * 16 + hexDigit(hex[2 * i + 1]));
+    }
+    return bytes;
+}
+
+PatternSummary parseIndexLine(const std::string& line) {
+    std::vector<std::string> fields;
+    std::string::size_type start = 0;
+    while (true) {
+        std::string::size_type tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab - start));
+        if (tab == std::string::npos) break;
+        start = tab + 1;
+    }
+    if (fields.size() != kNumFields) throw std::runtime_error("wrong number of fields");
+    PatternSummary summary;
+    summary.path = fields[0];
+    summary.modified = std::stoll(fields[1]);
+    summary.size = std::stoll(fields[2]);
+    summary.contentHash = std::stoull(fields[3], nullptr, 16);
+    summary.numRows = std::stoi(fields[4]);
+    summary.numCols = std::stoi(fields[5]);
+    summary.population = std::stoll(fields[6]);
+    summary.top = std::stoi(fields[7]);
+    summary.left = std::stoi(fields[8]);
+    summary.bottom = std::stoi(fields[9]);
+    summary.right = std::stoi(fields[10]);
+    summary.period = std::stoi(fields[11]);
+    summary.rule = fields[12];
+    summary.thumbnailRows = std::stoi(fields[13]);
+    summary.thumbnailCols = std::stoi(fields[14]);
+    summary.thumbnail = fromHex(fields[15]);
+    summary.error = fields[16];
+    if (summary.thumbnail.size() != static_cast<size_t>(summary.thumbnailRows) * summary.thumbnailCols) {
+        throw std::runtime_error("bad thumbnail size");
+    }
+    return summary;
+}
+}
+
+PatternSummary::PatternSummary() :
+    modified(0), size(0), contentHash(0), numRows(0), numCols(0), population(0),
+    top(-1), left(-1), bottom(-1), right(-1), period(0), thumbnailRows(0), thumbnailCols(0) {
+}
+
+std::string PatternSummary::getName() const {
+    std::string::size_type slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+PatternSummary summarizePatternFile(const std::string& filename) {
+    TRACE_SPAN("summarize pattern");
+    PatternSummary summary;
+    summary.path = filename;
+    try {
+        if (!getFileStamp(filename, summary.modified, summary.size)) {
+            throw std::runtime_error("cannot open \"" + filename + "\"");
+        }
+        summary.contentHash = hashFile(filename);
+        SimulationGrid grid;
+        LifeRule rule;
+        readPatternFile(filename, grid, &rule);
+        summary.numRows = grid.getNumRows();
+        summary.numCols = grid.getNumCols();
+        summary.population = grid.getPopulation();
+        findBounds(grid, summary.top, summary.left, summary.bottom, summary.right);
+        summary.period = findPeriod(grid, rule);
+        summary.rule = rule.toString();
+        makeThumbnail(grid, summary);
+    }
+    catch (const std::exception& ex) {
+        PatternSummary failed;
+        failed.path = summary.path;
+        failed.modified = summary.modified;
+        failed.size = summary.size;
+        failed.contentHash = summary.contentHash;
+        failed.error = ex.what();
+        return failed;
+    }
+    return summary;
+}
+
+PatternCatalogue::PatternCatalogue(const std::string& indexFile) :
+    indexFile(indexFile), parsedCount(0) {
+}
+
+void PatternCatalogue::scan(const std::vector<std::string>& directories, int numThreads) {
+    TRACE_SPAN("scan patterns");
+    if (indexed.empty()) loadIndex();
+    std::vector<std::string> paths;
+    for (const std::string& directory : directories) {
+        std::vector<std::string> files = listPatternFiles(directory);
+        paths.insert(paths.end(), files.begin(), files.end());
+    }
+
+    // Each thread takes the next file nobody has started on, so one huge
+    // file does not hold up the rest.
+    std::vector<PatternSummary> found(paths.size());
+    std::vector<char> parsed(paths.size(), 0);
+    std::atomic<size_t> nextFile(0);
+    auto work = [&]() {
+        for (size_t i = nextFile++; i < paths.size(); i = nextFile++) {
+            auto cached = indexed.find(paths[i]);
+            long long modified, size;
+            if (cached != indexed.end() && getFileStamp(paths[i], modified, size) && size == cached->second.size) {
+                if (modified == cached->second.modified) {
+                    found[i] = cached->second;
+                    continue;
+                }
+                try {
+                    if (hashFile(paths[i]) == cached->second.contentHash) { // touched but not changed
+                        found[i] = cached->second;
+                        found[i].modified = modified;
+                        continue;
+                    }
+                }
+                catch (const std::runtime_error&) {
+                    // summarized as unreadable below
+                }
+            }
+            found[i] = summarizePatternFile(paths[i]);
+            parsed[i] = 1;
+        }
+    };
+    if (numThreads <= 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+    numThreads = static_cast<int>(std::min<size_t>(numThreads, std::max<size_t>(paths.size(), 1)));
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < numThreads; i++) {
+        helpers.emplace_back([&work, i]() {
+            Tracer::setThreadName("catalogue " + std::to_string(i));
+            work();
+        });
+    }
+    work();
+    for (std::thread& helper : helpers) helper.join();
+
+    bool changed = found.size() != indexed.size();
+    parsedCount = 0;
+    std::map<std::string, PatternSummary> scanned;
+    for (size_t i = 0; i < found.size(); i++) {
+        parsedCount += parsed[i];
+        auto cached = indexed.find(found[i].path);
+        changed = changed || parsed[i] || cached == indexed.end() || cached->second.modified != found[i].modified;
+        scanned[found[i].path] = found[i];
+    }
+    patterns.swap(found);
+    indexed.swap(scanned);
+    LOG_DEBUG("catalogue: " << patterns.size() << " patterns, " << parsedCount << " parsed");
+    if (changed) saveIndex();
+}
+
+const std::vector<PatternSummary>& PatternCatalogue::getPatterns() const {
+    return patterns;
+}
+
+int PatternCatalogue::getParsedCount() const {
+    return parsedCount;
+}
+
+void PatternCatalogue::loadIndex() {
+    std::ifstream input(indexFile);
+    if (!input) return; // first run
+    std::string line;
+    std::string expected = std::string(kIndexHeader) + " " + std::to_string(kCatalogueVersion);
+    if (!std::getline(input, line) || line != expected) {
+        LOG_WARNING("ignoring pattern index " << indexFile << ": not a version " << kCatalogueVersion << " index");
+        return;
+    }
+    try {
+        while (std::getline(input, line)) {
+            PatternSummary summary = parseIndexLine(line);
+            indexed[summary.path] = summary;
+        }
+    }
+    catch (const std::exception& ex) {
+        LOG_WARNING("ignoring damaged pattern index " << indexFile << ": " << ex.what());
+        indexed.clear();
+    }
+}
+
+void PatternCatalogue::saveIndex() const {
+    // written beside the old index and renamed over it, as snapshots are
+    std::string temporary = indexFile + ".tmp";
+    {
+        std::ofstream output(temporary, std::ios::trunc);
+        output << kIndexHeader << " " << kCatalogueVersion << '\n';
+        for (const auto& entry : indexed) {
+            const PatternSummary& summary = entry.second;
+            if (summary.path != sanitize(summary.path)) continue; // cannot be stored; parsed every time
+            output << summary.path << '\t' << summary.modified << '\t' << summary.size << '\t'
+                   << std::hex << summary.contentHash << std::dec << '\t'
+                   << summary.numRows << '\t' << summary.numCols << '\t' << summary.population << '\t'
+                   << summary.top << '\t' << summary.left << '\t' << summary.bottom << '\t' << summary.right << '\t'
+                   << summary.period << '\t' << summary.rule << '\t'
+                   << summary.thumbnailRows << '\t' << summary.thumbnailCols << '\t' << toHex(summary.thumbnail) << '\t'
+                   << sanitize(summary.error) << '\n';
+        }
+        if (!output) {
+            std::remove(temporary.c_str());
+            LOG_WARNING("cannot write pattern index " << temporary);
+            return;
+        }
+    }
+#ifdef _WIN32
+    std::remove(indexFile.c_str()); // rename does not replace files on Windows
+#endif
+    if (std::rename(temporary.c_str(), indexFile.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        LOG_WARNING("cannot replace pattern index " << indexFile);
+    }
+}
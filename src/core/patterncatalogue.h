@@ -0,0 +1,107 @@
+/**
+ * File: patterncatalogue.h
+ * ------------------------
+ * Defines a catalogue of the pattern files in a set of directories, with
+ * what a picker needs to show for each (size, population, bounding box,
+ * period and a small thumbnail), so that hundreds of patterns can be listed
+ * at once without reading any of them.
+ *
+ * The summaries are kept in an index file between runs. A file is only read
+ * again when its size or modification time has changed, and only parsed
+ * again when its contents have changed as well. Files that are read are
+ * spread over several threads.
+ *
+ * The index is a text file: the line "LIFECAT <version>", then one line per
+ * file with its fields separated by tabs, in the order they are declared in
+ * PatternSummary, the thumbnail as hexadecimal digits.
+ */
+
+#pragma once
+#include <cstdint> // for uint64_t
+#include <map>     // for std::map
+#include <string>  // for std::string
+#include <vector>  // for std::vector
+
+const unsigned int kCatalogueVersion = 1;
+
+/**
+ * What the catalogue knows about one pattern file.
+ */
+struct PatternSummary {
+    std::string path;
+    long long modified;    // seconds since the epoch
+    long long size;        // in bytes
+    uint64_t contentHash;  // 64-bit FNV-1a of the file's bytes
+    int numRows;
+    int numCols;
+    long long population;
+    int top, left, bottom, right; // rows and columns of the outermost live cells; all -1 if there are none
+    int period;            // generations until the live cells repeat, possibly moved; 0 if not found
+    std::string rule;      // the file's rule, or B3/S23 if it gives none
+    int thumbnailRows;
+    int thumbnailCols;
+    std::vector<unsigned char> thumbnail; // row by row, 0 (all dead) to 255 (all alive)
+    std::string error;     // why the file could not be read; the fields above are then unset
+
+    PatternSummary();
+
+/**
+ * Returns the file name without its directory.
+ */
+    std::string getName() const;
+};
+
+/**
+ * Largest thumbnail side, in pixels; bigger boards are scaled down to fit.
+ */
+const int kThumbnailSize = 32;
+
+/**
+ * Longest period looked for. Periods are only looked for on boards of up to
+ * kMaxPeriodCells cells, as it means running the pattern that many times.
+ */
+const int kMaxPeriod = 64;
+const long long kMaxPeriodCells = 1 << 20;
+
+/**
+ * Reads the named pattern file (any format readPatternFile accepts) and
+ * summarizes it. Never throws: failures are reported in the error field.
+ */
+PatternSummary summarizePatternFile(const std::string& filename);
+
+class PatternCatalogue {
+public:
+/**
+ * Creates an empty catalogue, using the named index file to remember
+ * summaries between runs.
+ */
+    explicit PatternCatalogue(const std::string& indexFile);
+
+/**
+ * Lists the pattern files in the given directories (see listPatternFiles)
+ * and summarizes them, reusing the index wherever a file is unchanged, on
+ * numThreads threads (0 means one per hardware thread). Then rewrites the
+ * index if anything changed. A missing or damaged index only makes the scan
+ * slower, and an index that cannot be written is only logged.
+ */
+    void scan(const std::vector<std::string>& directories, int numThreads = 0);
+
+/**
+ * Returns the summaries found by the last scan, by directory and then by name.
+ */
+    const std::vector<PatternSummary>& getPatterns() const;
+
+/**
+ * Returns how many files the last scan had to parse.
+ */
+    int getParsedCount() const;
+
+private:
+    void loadIndex();
+    void saveIndex() const;
+
+    std::string indexFile;
+    std::vector<PatternSummary> patterns;
+    std::map<std::string, PatternSummary> indexed; // by path, as of the last load or scan
+    int parsedCount;
+};
@@ -0,0 +1,629 @@
+/**
+ * File: patternio.cpp
+ * -------------------
+ * Implementation of plaintext, RLE and macrocell pattern reading, and
+ * plaintext and macrocell writing.
+ */
+
+#include <algorithm> // for min, sort, fill_n
+#include <cctype>    // for isspace
+#include <cstdio>    // for sscanf
+#include <cstdlib>   // for strtol
+#include <cstring>   // for memchr
+#include <sstream>   // for istringstream
+#include <stdexcept> // for runtime_error
+#include <streambuf> // for std::streambuf
+#include <unordered_map> // for std::unordered_map
+#ifdef _WIN32
+#include <windows.h> // for FindFirstFileA
+#else
+#include <dirent.h>   // for opendir
+#include <sys/stat.h> // for stat
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h> // for SSE2 byte comparisons
+#endif
+
+#include "patternio.h"
+#include "mappedfile.h"
+#include "snapshot.h"
+
+namespace {
+// Reads the next line into line, dropping a trailing '\r' left by Windows line endings.
+bool readLine(std::istream& input, std::string& line) {
+    if (!std::getline(input, line)) return false;
+    if (!line.empty() && line[line.size() - 1] == '\r') {
+        line.erase(line.size() - 1);
+    }
+    return true;
+}
+
+int parseDimension(const std::string& line, const char* what) {
+    int value = 0;
+    try {
+        value = std::stoi(line);
+    }
+    catch (const std::logic_error&) {
+        throw std::runtime_error(std::string("readPattern: bad number of ") + what + ": \"" + line + "\"");
+    }
+    if (value <= 0) {
+        throw std::runtime_error(std::string("readPattern: number of ") + what + " must be positive");
+    }
+    return value;
+}
+
+// The largest board a pattern file may ask for, so that a bad header fails cleanly instead of exhausting memory.
+const long long kMaxBoardSide = 1 << 16;
+const long long kMaxBoardCells = 1LL << 28; // a gigabyte of cells
+
+bool isBoardTooLarge(long long numRows, long long numCols) {
+    return numRows > kMaxBoardSide || numCols > kMaxBoardSide || numRows * numCols > kMaxBoardCells;
+}
+
+std::string describeBoard(long long numRows, long long numCols) {
+    return std::to_string(numCols) + "x" + std::to_string(numRows);
+}
+
+// Consumes comment lines and blank lines, leaving the stream at the header.
+void skipComments(std::istream& input) {
+    std::string line;
+    while (true) {
+        int ch = input.peek();
+        if (ch == '#') {
+            std::getline(input, line);
+        }
+        else if (ch == '\n' || ch == '\r') {
+            input.get();
+        }
+        else {
+            return;
+        }
+    }
+}
+
+std::string trim(const std::string& text) {
+    size_t first = 0;
+    size_t last = text.size();
+    while (first < last && std::isspace(static_cast<unsigned char>(text[first]))) first++;
+    while (last > first && std::isspace(static_cast<unsigned char>(text[last - 1]))) last--;
+    return text.substr(first, last - first);
+}
+
+/*
+ * Parses "x = 3, y = 3, rule = B3/S23". Anything after a ':' in the rule
+ * (Golly's bounded grid suffix) is ignored; the board always wraps around.
+ */
+void parseRleHeader(const std::string& line, int& numCols, int& numRows, std::string& ruleText) {
+    numCols = -1;
+    numRows = -1;
+    std::istringstream fields(line);
+    std::string field;
+    bool inRule = false;
+    while (std::getline(fields, field, ',')) {
+        size_t equals = field.find('=');
+        if (equals == std::string::npos && inRule) {
+            continue; // the rest of a bounded grid suffix such as ":T10,10"
+        }
+        if (equals == std::string::npos) {
+            throw std::runtime_error("readRlePattern: bad header field \"" + trim(field) + "\"");
+        }
+        std::string key = trim(field.substr(0, equals));
+        std::string value = trim(field.substr(equals + 1));
+        inRule = key == "rule";
+        if (key == "x") {
+            numCols = parseDimension(value, "columns");
+        }
+        else if (key == "y") {
+            numRows = parseDimension(value, "rows");
+        }
+        else if (key == "rule") {
+            ruleText = value.substr(0, value.find(':'));
+        }
+    }
+    if (numCols < 0 || numRows < 0) {
+        throw std::runtime_error("readRlePattern: header must give x and y");
+    }
+}
+
+// Parses a macrocell leaf such as "$$..*$...*$.***$": '$' ends a row.
+uint64_t parseMacrocellLeaf(const std::string& line) {
+    uint64_t cells = 0;
+    int row = 0;
+    int col = 0;
+    for (char ch : line) {
+        if (ch == '$') {
+            row++;
+            col = 0;
+        }
+        else if (ch == '.' || ch == '*') {
+            if (row >= 8 || col >= 8) {
+                throw std::runtime_error("readMacrocell: leaf larger than 8x8: \"" + line + "\"");
+            }
+            if (ch == '*') cells |= 1ULL << (row * 8 + col);
+            col++;
+        }
+        else {
+            throw std::runtime_error(std::string("readMacrocell: unexpected '") + ch + "' in a leaf");
+        }
+    }
+    return cells;
+}
+
+/*
+ * Numbers the nodes under a root in the order they are written, children
+ * first, so that every line refers only to lines above it.
+ */
+class MacrocellWriter {
+public:
+    MacrocellWriter(std::ostream& output, const Quadtree& tree) :
+        output(output), tree(tree), nextNumber(1) {
+    }
+
+    int write(Quadtree::NodeId node) {
+        if (node == Quadtree::kEmpty) return 0;
+        auto found = numbers.find(node);
+        if (found != numbers.end()) return found->second;
+        int level = tree.getLevel(node);
+        if (level == Quadtree::kLeafLevel) {
+            writeLeaf(tree.getLeafCells(node));
+        }
+        else {
+            int children[4];
+            for (int quadrant = 0; quadrant < 4; quadrant++) {
+                children[quadrant] = write(tree.getChild(node, quadrant));
+            }
+            output << level << ' ' << children[0] << ' ' << children[1] << ' '
+                   << children[2] << ' ' << children[3] << '\n';
+        }
+        numbers[node] = nextNumber;
+        return nextNumber++;
+    }
+
+    void writeLeaf(uint64_t cells) {
+        std::string line;
+        int lastRow = 7;
+        while (lastRow >= 0 && ((cells >> (lastRow * 8)) & 0xff) == 0) lastRow--;
+        for (int row = 0; row <= lastRow; row++) {
+            unsigned int bits = (cells >> (row * 8)) & 0xff;
+            for (int col = 0; bits >> col != 0; col++) {
+                line += (bits >> col) & 1 ? '*' : '.';
+            }
+            line += '$';
+        }
+        output << (line.empty() ? "$" : line) << '\n';
+    }
+
+private:
+    std::ostream& output;
+    const Quadtree& tree;
+    std::unordered_map<Quadtree::NodeId, int> numbers;
+    int nextNumber;
+};
+
+/*
+ * Lets the stream-based readers run over bytes already in memory, such as a
+ * mapped file, without copying them.
+ */
+class MemoryStreamBuffer : public std::streambuf {
+public:
+    MemoryStreamBuffer(const char* begin, const char* end) {
+        char* first = const_cast<char*>(begin); // never written through
+        setg(first, first, const_cast<char*>(end));
+    }
+};
+
+// Returns the start of the first line after any comment or blank lines.
+const char* skipComments(const char* text, const char* end) {
+    while (text < end && (*text == '#' || *text == '\n' || *text == '\r')) {
+        if (*text == '#') {
+            const char* newline = static_cast<const char*>(std::memchr(text, '\n', end - text));
+            text = newline == nullptr ? end : newline;
+        }
+        text++;
+    }
+    return std::min(text, end);
+}
+
+// Finds the end of the line starting at text, leaving out a '\r' before the '\n'.
+const char* findLineEnd(const char* text, const char* end, const char*& next) {
+    const char* newline = static_cast<const char*>(std::memchr(text, '\n', end - text));
+    next = newline == nullptr ? end : newline + 1;
+    const char* lineEnd = newline == nullptr ? end : newline;
+    if (lineEnd > text && lineEnd[-1] == '\r') lineEnd--;
+    return lineEnd;
+}
+
+/*
+ * Sets row[j] to 1 for each live cell character ('X', or 'O' in .cells
+ * files) among the first length characters of text, and to 0 otherwise.
+ * Sixteen characters are classified at a time where SSE2 is available.
+ */
+void classifyCells(const char* text, int length, int* row) {
+    int j = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    const __m128i liveX = _mm_set1_epi8('X');
+    const __m128i liveO = _mm_set1_epi8('O');
+    for (; j + 16 <= length; j += 16) {
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + j));
+        unsigned int live = static_cast<unsigned int>(_mm_movemask_epi8(
+                    _mm_or_si128(_mm_cmpeq_epi8(chars, liveX), _mm_cmpeq_epi8(chars, liveO))));
+        for (int k = 0; k < 16; k++) {
+            row[j + k] = (live >> k) & 1;
+        }
+    }
+#endif
+    for (; j < length; j++) {
+        row[j] = (text[j] == 'X' || text[j] == 'O') ? 1 : 0;
+    }
+}
+
+/*
+ * Reads a board in the res/files format (text starts at the number of
+ * rows) or in the .cells format ('!' comments, then '.' and 'O' rows as
+ * long as they need to be), straight from the file's bytes.
+ */
+void readPlaintext(const char* text, const char* end, SimulationGrid& grid) {
+    const char* next;
+    int numRows;
+    int numCols;
+    bool cellsFormat = text < end && !(*text >= '0' && *text <= '9') && *text != '-' && *text != '+';
+    if (cellsFormat) {
+        // first pass: only line lengths, to size the board
+        while (text < end && *text == '!') {
+            findLineEnd(text, end, next);
+            text = next;
+        }
+        numRows = 0;
+        numCols = 1;
+        for (const char* line = text; line < end; line = next) {
+            const char* lineEnd = findLineEnd(line, end, next);
+            numCols = std::max(numCols, static_cast<int>(lineEnd - line));
+            numRows++;
+        }
+        numRows = std::max(numRows, 1);
+    }
+    else {
+        if (text >= end) {
+            throw std::runtime_error("readPattern: missing number of rows");
+        }
+        const char* lineEnd = findLineEnd(text, end, next);
+        numRows = parseDimension(std::string(text, lineEnd), "rows");
+        text = next;
+        if (text >= end) {
+            throw std::runtime_error("readPattern: missing number of columns");
+        }
+        lineEnd = findLineEnd(text, end, next);
+        numCols = parseDimension(std::string(text, lineEnd), "columns");
+        text = next;
+    }
+    if (isBoardTooLarge(numRows, numCols)) {
+        throw std::runtime_error("readPattern: a " + describeBoard(numRows, numCols) + " board is too large");
+    }
+
+    grid.setGridFieldsEmpty(numRows, numCols);
+    for (int i = 0; i < numRows && text < end; i++) {
+        const char* lineEnd = findLineEnd(text, end, next);
+        int length = static_cast<int>(std::min<long long>(lineEnd - text, numCols));
+        classifyCells(text, length, grid.getGrid()[i]);
+        text = next;
+    }
+}
+
+/*
+ * Reads a macrocell pattern and expands it into a board: the board its
+ * torus suffix gives, if any, or else one just big enough for its live cells.
+ */
+void readMacrocellBoard(std::istream& input, const std::string& filename, SimulationGrid& grid, LifeRule* rule) {
+    Quadtree tree;
+    int numRows = 0;
+    int numCols = 0;
+    readMacrocell(input, tree, rule, nullptr, &numRows, &numCols);
+    long long top = 0, left = 0, bottom = 0, right = 0;
+    bool hasCells = tree.getBounds(top, left, bottom, right);
+    if (numRows > 0) {
+        // the board is centred on the root, as Golly writes it
+        if (isBoardTooLarge(numRows, numCols)) {
+            throw std::runtime_error("readPatternFile: \"" + filename + "\" has a "
+                                     + describeBoard(numRows, numCols) + " board, too large");
+        }
+        long long boardTop = Quadtree::getBoardOffset(tree.getRootLevel(), numRows);
+        long long boardLeft = Quadtree::getBoardOffset(tree.getRootLevel(), numCols);
+        if (hasCells && (top < boardTop || left < boardLeft
+                         || bottom >= boardTop + numRows || right >= boardLeft + numCols)) {
+            throw std::runtime_error("readPatternFile: \"" + filename + "\" has live cells outside its "
+                                     + describeBoard(numRows, numCols) + " board");
+        }
+        tree.toGrid(grid, boardTop, boardLeft, numRows, numCols);
+    }
+    else if (!hasCells) {
+        grid.setGridFieldsEmpty(1, 1);
+    }
+    else if (isBoardTooLarge(bottom - top + 1, right - left + 1)) {
+        throw std::runtime_error("readPatternFile: \"" + filename + "\" spans "
+                                 + describeBoard(bottom - top + 1, right - left + 1)
+                                 + " cells, too many for a board");
+    }
+    else {
+        tree.toGrid(grid, top, left, static_cast<int>(bottom - top + 1), static_cast<int>(right - left + 1));
+    }
+}
+}
+
+void readPattern(std::istream& input, SimulationGrid& grid) {
+    std::string line;
+    do {
+        if (!readLine(input, line)) {
+            throw std::runtime_error("readPattern: missing number of rows");
+        }
+    } while (!line.empty() && line[0] == '#');
+    int numRows = parseDimension(line, "rows");
+    if (!readLine(input, line)) {
+        throw std::runtime_error("readPattern: missing number of columns");
+    }
+    int numCols = parseDimension(line, "columns");
+    if (isBoardTooLarge(numRows, numCols)) {
+        throw std::runtime_error("readPattern: a " + describeBoard(numRows, numCols) + " board is too large");
+    }
+
+    grid.setGridFieldsEmpty(numRows, numCols);
+    for (int i = 0; i < numRows && readLine(input, line); i++) {
+        int* row = grid.getGrid()[i];
+        int length = std::min(static_cast<int>(line.size()), numCols);
+        for (int j = 0; j < length; j++) {
+            row[j] = (line[j] == 'X') ? 1 : 0;
+        }
+    }
+}
+
+void readRlePattern(std::istream& input, SimulationGrid& grid, LifeRule* rule) {
+    skipComments(input);
+    std::string line;
+    if (!readLine(input, line)) {
+        throw std::runtime_error("readRlePattern: missing header");
+    }
+    int numCols;
+    int numRows;
+    std::string ruleText;
+    parseRleHeader(line, numCols, numRows, ruleText);
+    if (isBoardTooLarge(numRows, numCols)) {
+        throw std::runtime_error("readRlePattern: a " + describeBoard(numRows, numCols) + " board is too large");
+    }
+    if (rule != nullptr && !ruleText.empty()) {
+        try {
+            *rule = LifeRule::parse(ruleText);
+        }
+        catch (const std::invalid_argument&) {
+            throw std::runtime_error("readRlePattern: unsupported rule \"" + ruleText + "\"");
+        }
+    }
+
+    grid.setGridFieldsEmpty(numRows, numCols);
+    int** cells = grid.getGrid();
+    const long long kMaxRun = 1LL << 31;
+    const std::streamsize kChunkSize = 1 << 16;
+    std::vector<char> chunk(kChunkSize);
+    long long run = 0; // 0 until a count has been read
+    int row = 0;
+    int col = 0;
+    bool inComment = false;
+    bool done = false;
+    while (!done && input) {
+        input.read(chunk.data(), kChunkSize);
+        std::streamsize length = input.gcount();
+        for (std::streamsize i = 0; i < length && !done; i++) {
+            char ch = chunk[i];
+            if (inComment) {
+                inComment = ch != '\n';
+                continue;
+            }
+            if (ch >= '0' && ch <= '9') {
+                run = run * 10 + (ch - '0');
+                if (run > kMaxRun) {
+                    throw std::runtime_error("readRlePattern: run length too long");
+                }
+                continue;
+            }
+            if (std::isspace(static_cast<unsigned char>(ch))) {
+                continue; // lines may break anywhere, even inside a count
+            }
+            long long count = run == 0 ? 1 : run;
+            run = 0;
+            if (ch == 'b' || ch == '.') {
+                col = static_cast<int>(std::min<long long>(col + count, numCols));
+            }
+            else if (ch == 'o' || (ch >= 'A' && ch <= 'X')) { // any non-zero state is alive
+                if (row >= numRows || col + count > numCols) {
+                    throw std::runtime_error("readRlePattern: live cells outside the "
+                                             + std::to_string(numCols) + "x" + std::to_string(numRows) + " board");
+                }
+                std::fill_n(cells[row] + col, count, 1);
+                col += static_cast<int>(count);
+            }
+            else if (ch == '$') {
+                row = static_cast<int>(std::min<long long>(row + count, numRows));
+                col = 0;
+            }
+            else if (ch == '!') {
+                done = true;
+            }
+            else if (ch == '#') {
+                inComment = true;
+            }
+            else {
+                throw std::runtime_error(std::string("readRlePattern: unexpected '") + ch + "'");
+            }
+        }
+    }
+}
+
+void readMacrocell(std::istream& input, Quadtree& tree, LifeRule* rule, long long* generation,
+                   int* numRows, int* numCols) {
+    std::string line;
+    if (!readLine(input, line) || line.compare(0, 4, "[M2]") != 0) {
+        throw std::runtime_error("readMacrocell: missing [M2] header");
+    }
+    // file node numbers start at 1; 0 is the empty node
+    std::vector<Quadtree::NodeId> ids(1, Quadtree::kEmpty);
+    std::vector<int> levels(1, -1);
+    if (numRows != nullptr) *numRows = 0;
+    if (numCols != nullptr) *numCols = 0;
+    while (readLine(input, line)) {
+        if (line.empty()) continue;
+        if (line[0] == '#') {
+            if (line.compare(0, 2, "#R") == 0) {
+                std::string ruleText = trim(line.substr(2));
+                size_t suffix = ruleText.find(':');
+                if (rule != nullptr) {
+                    try {
+                        *rule = LifeRule::parse(ruleText.substr(0, suffix));
+                    }
+                    catch (const std::invalid_argument&) {
+                        throw std::runtime_error("readMacrocell: unsupported rule \"" + ruleText + "\"");
+                    }
+                }
+                // Golly's torus suffix, ":T<columns>,<rows>"; other topologies are read as unbounded
+                int cols = 0, rows = 0;
+                char extra;
+                if (suffix != std::string::npos
+                        && std::sscanf(ruleText.c_str() + suffix, ":T%d,%d%c", &cols, &rows, &extra) == 2
+                        && cols > 0 && rows > 0) {
+                    if (numRows != nullptr) *numRows = rows;
+                    if (numCols != nullptr) *numCols = cols;
+                }
+            }
+            else if (line.compare(0, 2, "#G") == 0 && generation != nullptr) {
+                *generation = std::strtoll(line.c_str() + 2, nullptr, 10);
+            }
+            continue;
+        }
+        if (line[0] == '.' || line[0] == '*' || line[0] == '$') {
+            ids.push_back(tree.makeLeaf(parseMacrocellLeaf(line)));
+            levels.push_back(Quadtree::kLeafLevel);
+            continue;
+        }
+        const char* text = line.c_str();
+        char* end;
+        long values[5];
+        for (long& value : values) {
+            value = std::strtol(text, &end, 10);
+            if (end == text) {
+                throw std::runtime_error("readMacrocell: bad node \"" + line + "\"");
+            }
+            text = end;
+        }
+        int level = static_cast<int>(values[0]);
+        if (level <= Quadtree::kLeafLevel || level > Quadtree::kMaxLevel) {
+            throw std::runtime_error("readMacrocell: unsupported node level in \"" + line
+                                     + "\" (only two-state patterns with 8x8 leaves are read)");
+        }
+        Quadtree::NodeId children[4];
+        for (int quadrant = 0; quadrant < 4; quadrant++) {
+            long number = values[quadrant + 1];
+            if (number < 0 || number >= static_cast<long>(ids.size())
+                    || (number != 0 && levels[number] != level - 1)) {
+                throw std::runtime_error("readMacrocell: bad child in \"" + line + "\"");
+            }
+            children[quadrant] = ids[number];
+        }
+        ids.push_back(tree.makeNode(level, children[0], children[1], children[2], children[3]));
+        levels.push_back(level);
+    }
+    if (ids.size() == 1) {
+        throw std::runtime_error("readMacrocell: no nodes");
+    }
+    tree.setRoot(ids.back(), levels.back()); // the last node is the root
+}
+
+void writeMacrocell(std::ostream& output, const Quadtree& tree, const LifeRule& rule, long long generation,
+                    int numRows, int numCols) {
+    output << "[M2] (game-of-life)\n#R " << rule.toString();
+    if (numRows > 0 && numCols > 0) {
+        output << ":T" << numCols << ',' << numRows;
+    }
+    output << '\n';
+    if (generation != 0) {
+        output << "#G " << generation << '\n';
+    }
+    MacrocellWriter writer(output, tree);
+    if (writer.write(tree.getRoot()) == 0) {
+        writer.writeLeaf(0); // an empty universe is one empty leaf
+    }
+}
+
+void readPatternFile(const std::string& filename, SimulationGrid& grid, LifeRule* rule) {
+    MappedFile file(filename);
+    file.adviseSequential();
+    if (isSnapshot(file.getData(), file.getSize())) {
+        SnapshotInfo info;
+        readSnapshot(file.getData(), file.getSize(), grid, &info);
+        if (rule != nullptr) *rule = info.rule;
+        return;
+    }
+    const char* end = file.getData() + file.getSize();
+    const char* text = skipComments(file.getData(), end);
+    if (text < end && (*text == '[' || *text == 'x')) {
+        MemoryStreamBuffer buffer(text, end);
+        std::istream input(&buffer);
+        if (*text == '[') {
+            readMacrocellBoard(input, filename, grid, rule);
+        }
+        else {
+            readRlePattern(input, grid, rule);
+        }
+    }
+    else {
+        readPlaintext(text, end, grid);
+    }
+}
+
+void writePattern(std::ostream& output, const SimulationGrid& grid, const std::string& comment) {
+    if (!comment.empty()) {
+        std::istringstream lines(comment);
+        std::string line;
+        while (std::getline(lines, line)) {
+            output << "# " << line << '\n';
+        }
+    }
+    output << grid.getNumRows() << '\n' << grid.getNumCols() << '\n';
+    std::string row;
+    for (int i = 0; i < grid.getNumRows(); i++) {
+        row.assign(grid.getNumCols(), '-');
+        for (int j = 0; j < grid.getNumCols(); j++) {
+            if (grid.getGrid()[i][j] != 0) row[j] = 'X';
+        }
+        output << row << '\n';
+    }
+}
+
+std::vector<std::string> listPatternFiles(const std::string& directory) {
+    std::vector<std::string> paths;
+    std::string prefix = directory;
+    if (!prefix.empty() && prefix[prefix.size() - 1] != '/' && prefix[prefix.size() - 1] != '\\') {
+        prefix += '/';
+    }
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    HANDLE handle = FindFirstFileA((prefix + "*").c_str(), &entry);
+    if (handle == INVALID_HANDLE_VALUE) return paths;
+    do {
+        if (entry.cFileName[0] != '.' && !(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+            paths.push_back(prefix + entry.cFileName);
+        }
+    } while (FindNextFileA(handle, &entry));
+    FindClose(handle);
+#else
+    DIR* dir = opendir(directory.c_str());
+    if (dir == nullptr) return paths;
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        std::string path = prefix + entry->d_name;
+        struct stat info;
+        if (stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode)) {
+            paths.push_back(path);
+        }
+    }
+    closedir(dir);
+#endif
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
@@ -0,0 +1,105 @@
+/**
+ * File: patternio.h
+ * -----------------
+ * Reads and writes boards in the plaintext format of the files in res/files:
+ * any number of '#' comment lines, a line with the number of rows, a line
+ * with the number of columns, then one line per row with '-' for a dead cell
+ * and 'X' for a live one. Also reads the run length encoded (RLE) format
+ * used by most public pattern collections,
+ *
+ *    #N Glider
+ *    x = 3, y = 3, rule = B3/S23
+ *    bob$2bo$3o!
+ *
+ * and the macrocell (.mc) format, which describes a pattern as a quadtree
+ * of 8x8 leaves so that even astronomically large patterns stay small:
+ *
+ *    [M2] (golly 4.2)
+ *    #R B3/S23
+ *    $$..*$...*$.***$
+ *    4 1 0 0 0
+ *
+ * Live cells are read in with age 1.
+ */
+
+#pragma once
+#include <istream> // for std::istream
+#include <ostream> // for std::ostream
+#include <string>  // for std::string
+#include <vector>  // for std::vector
+
+#include "simulationgrid.h"
+#include "liferule.h"
+#include "quadtree.h"
+
+/**
+ * Reads a board from the given stream into grid, replacing its contents.
+ * Rows shorter than the number of columns are padded with dead cells.
+ * Throws std::runtime_error if the header is missing or malformed or the
+ * board is too large.
+ */
+void readPattern(std::istream& input, SimulationGrid& grid);
+
+/**
+ * Reads an RLE board from the given stream into grid, replacing its
+ * contents. The board is x columns by y rows as given in the header. The
+ * body is decoded in a single pass over fixed-size chunks of the stream,
+ * straight into the grid's rows. If rule is not null and the header names a
+ * rule, it is stored there. Throws std::runtime_error if the header is
+ * missing or malformed, the board is too large, the rule is not a life-like
+ * rule, or live cells fall outside the board.
+ */
+void readRlePattern(std::istream& input, SimulationGrid& grid, LifeRule* rule = nullptr);
+
+/**
+ * Reads a macrocell pattern into tree, replacing its root, without ever
+ * expanding it to cells: each line of the file becomes one node, so the
+ * time taken depends on the number of distinct nodes rather than the area.
+ * If rule or generation are not null and the file gives them (#R and #G
+ * lines), they are stored there. If numRows and numCols are not null, they
+ * are set to the board size given by a torus suffix on the rule
+ * (":T<columns>,<rows>", as Golly writes it), or to 0 if there is none.
+ * Throws std::runtime_error if the file is malformed or not a two-state
+ * pattern.
+ */
+void readMacrocell(std::istream& input, Quadtree& tree, LifeRule* rule = nullptr, long long* generation = nullptr,
+                   int* numRows = nullptr, int* numCols = nullptr);
+
+/**
+ * Writes the nodes reachable from tree's root in macrocell format, each
+ * distinct node once, children before parents. If numRows and numCols are
+ * positive, the rule gets a torus suffix giving that board size; the board
+ * must then be centred on the root as Golly expects (see
+ * Quadtree::fromGrid).
+ */
+void writeMacrocell(std::ostream& output, const Quadtree& tree, const LifeRule& rule, long long generation = 0,
+                    int numRows = 0, int numCols = 0);
+
+/**
+ * Opens the named file and reads a board from it in whichever format it is
+ * in: the formats above or the .cells format ('!' comment lines, then rows
+ * of '.' and 'O'); the first line after the comments decides. The file is
+ * memory-mapped and plaintext rows are classified straight from the mapped
+ * bytes, sixteen at a time where the processor allows. Binary snapshots
+ * (see snapshot.h) are read too, ages included. For RLE, macrocell and
+ * snapshot files, rule is set as readRlePattern does. A macrocell pattern
+ * takes its board size from a torus suffix on its rule, the board being
+ * centred on the root as Golly places it; without one, the board is the
+ * smallest rectangle around its live cells. Throws std::runtime_error if
+ * the file cannot be opened or read, if the board is too large, or if live
+ * cells fall outside a macrocell pattern's board.
+ */
+void readPatternFile(const std::string& filename, SimulationGrid& grid, LifeRule* rule = nullptr);
+
+/**
+ * Writes grid to the given stream in the same format, preceded by the
+ * given comment (one '#' line per line of comment) if it is not empty.
+ */
+void writePattern(std::ostream& output, const SimulationGrid& grid, const std::string& comment = "");
+
+/**
+ * Returns the paths of the regular files directly inside the given directory
+ * whose names do not start with '.', sorted by name. Returns an empty list if
+ * the directory cannot be read.
+ */
+std::vector<std::string> listPatternFiles(const std::string& directory);
@@ -0,0 +1,154 @@
+/**
+ * File: perfcounters.cpp
+ * ----------------------
+ * Implementation of the hardware counters on top of perf_event_open, with
+ * a stub for systems that do not have it.
+ */
+
+#include "perfcounters.h"
+
+#ifdef __linux__
+#include <cerrno>              // for errno
+#include <cstring>             // for memset, strerror
+#include <linux/perf_event.h>  // for perf_event_attr
+#include <sys/syscall.h>       // for SYS_perf_event_open
+#include <unistd.h>            // for syscall, read, close
+#endif
+
+namespace {
+
+const char* const kEventNames[PerfCounters::kNumEvents] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"
+};
+
+#ifdef __linux__
+struct EventConfig {
+    unsigned int type;
+    unsigned long long config;
+};
+
+const EventConfig kEventConfigs[PerfCounters::kNumEvents] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+                          | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                          | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+};
+
+/*
+ * Opens one counter for the calling thread and the threads it creates from
+ * now on, already running. Returns -1 and leaves errno set on failure.
+ */
+int openCounter(const EventConfig& event) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1; // allowed at the default perf_event_paranoid level
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+std::string describeFailure(int error) {
+    switch (error) {
+    case EACCES:
+    case EPERM:
+        return std::string(std::strerror(error)) + " (see /proc/sys/kernel/perf_event_paranoid)";
+    case ENOSYS:
+        return "perf_event_open is blocked or missing (common in containers)";
+    case ENOENT:
+    case EOPNOTSUPP:
+        return "not supported on this machine";
+    default:
+        return std::strerror(error);
+    }
+}
+#endif
+
+}
+
+PerfCounters::PerfCounters() {
+    for (int i = 0; i < kNumEvents; i++) {
+        fds[i] = -1;
+        startValues[i] = 0;
+    }
+#ifdef __linux__
+    for (int i = 0; i < kNumEvents; i++) {
+        fds[i] = openCounter(kEventConfigs[i]);
+        if (fds[i] < 0) {
+            std::string reason = describeFailure(errno);
+            if (!error.empty()) error += "; ";
+            error += std::string(kEventNames[i]) + ": " + reason;
+        }
+    }
+#else
+    error = "hardware counters are only supported on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (int i = 0; i < kNumEvents; i++) {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+#endif
+}
+
+bool PerfCounters::isAvailable() const {
+    for (int i = 0; i < kNumEvents; i++) {
+        if (fds[i] >= 0) return true;
+    }
+    return false;
+}
+
+bool PerfCounters::isAvailable(Event event) const {
+    return fds[event] >= 0;
+}
+
+const std::string& PerfCounters::getError() const {
+    return error;
+}
+
+void PerfCounters::start() {
+    for (int i = 0; i < kNumEvents; i++) {
+        startValues[i] = read(static_cast<Event>(i));
+    }
+}
+
+PerfCounters::Counts PerfCounters::stop() {
+    Counts counts;
+    for (int i = 0; i < kNumEvents; i++) {
+        counts.valid[i] = fds[i] >= 0;
+        counts.values[i] = counts.valid[i] ? read(static_cast<Event>(i)) - startValues[i] : 0;
+    }
+    return counts;
+}
+
+const char* PerfCounters::getEventName(Event event) {
+    return kEventNames[event];
+}
+
+/*
+ * The counters run continuously and are only ever read, so an interval is
+ * the difference of two readings. Each reading is scaled by the fraction of
+ * time the event actually had a hardware counter.
+ */
+double PerfCounters::read(Event event) const {
+#ifdef __linux__
+    if (fds[event] < 0) return 0;
+    unsigned long long values[3]; // value, time enabled, time running
+    if (::read(fds[event], values, sizeof(values)) != static_cast<ssize_t>(sizeof(values))) {
+        return 0;
+    }
+    if (values[2] == 0) return 0;
+    return static_cast<double>(values[0]) * values[1] / values[2];
+#else
+    (void) event;
+    return 0;
+#endif
+}
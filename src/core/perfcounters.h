@@ -0,0 +1,89 @@
+/**
+ * File: perfcounters.h
+ * --------------------
+ * Defines optional hardware performance counters (cycles, instructions,
+ * cache and branch misses) read through Linux's perf_event_open, for the
+ * benchmark and the headless runner:
+ *
+ *    PerfCounters counters;            // before the engine starts its threads
+ *    LifeEngine* engine = LifeEngine::create("parallel");
+ *    counters.start();
+ *    ... run generations ...
+ *    PerfCounters::Counts counts = counters.stop();
+ *
+ * Counting covers the thread that constructed the PerfCounters and every
+ * thread it starts afterwards, in user space only, so the engines' worker
+ * threads are included if they are created later.
+ *
+ * Counters are often unavailable: on other systems, in containers that
+ * block the system call, under a strict perf_event_paranoid setting, or on
+ * virtual machines that do not expose the PMU. Each counter that cannot be
+ * opened is simply left out; getError says why.
+ */
+
+#pragma once
+#include <string> // for std::string
+
+class PerfCounters {
+public:
+    enum Event {
+        CYCLES,
+        INSTRUCTIONS,
+        L1D_MISSES,    // level 1 data cache read misses
+        LLC_MISSES,    // last level cache misses
+        BRANCH_MISSES,
+        kNumEvents
+    };
+
+/**
+ * Counter values over one start/stop interval. Values are scaled up when
+ * the kernel had to share the hardware counters between events and so only
+ * counted for part of the interval.
+ */
+    struct Counts {
+        bool valid[kNumEvents];
+        double values[kNumEvents];
+    };
+
+/**
+ * Opens every counter the system allows. Never throws; check isAvailable.
+ */
+    PerfCounters();
+    ~PerfCounters();
+
+/**
+ * Returns whether at least one counter, or the given one, could be opened.
+ */
+    bool isAvailable() const;
+    bool isAvailable(Event event) const;
+
+/**
+ * Explains why some or all counters are missing, or returns "" if none are.
+ */
+    const std::string& getError() const;
+
+/**
+ * Marks the beginning of an interval.
+ */
+    void start();
+
+/**
+ * Returns the counts since the last call to start.
+ */
+    Counts stop();
+
+/**
+ * Returns a short identifier for the event, such as "llc_misses".
+ */
+    static const char* getEventName(Event event);
+
+private:
+    int fds[kNumEvents]; // -1 for counters that could not be opened
+    double startValues[kNumEvents];
+    std::string error;
+
+    double read(Event event) const;
+
+    PerfCounters(const PerfCounters& original);
+    void operator=(const PerfCounters& rhs);
+};
@@ -0,0 +1,104 @@
+/**
+ * File: pipelinestats.cpp
+ * -----------------------
+ * Implementation of the per-stage timing rings.
+ */
+
+#include <algorithm> // for nth_element, max_element
+#include <chrono>    // for steady_clock
+#include <thread>    // for sleep_for
+#include <vector>    // for std::vector
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // for __rdtsc
+#define PIPELINESTATS_USE_TSC 1
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h> // for __rdtsc
+#define PIPELINESTATS_USE_TSC 1
+#endif
+
+#include "pipelinestats.h"
+
+namespace {
+uint64_t steadyNanos() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+}
+
+PipelineStats::PipelineStats() {
+    for (Ring& ring : rings) {
+        for (std::atomic<uint64_t>& sample : ring.samples) {
+            sample.store(0, std::memory_order_relaxed);
+        }
+        ring.count.store(0, std::memory_order_relaxed);
+    }
+#ifdef PIPELINESTATS_USE_TSC
+    // time a short sleep with both clocks to learn the counter's rate
+    uint64_t startNanos = steadyNanos();
+    uint64_t startTicks = now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    uint64_t elapsedNanos = steadyNanos() - startNanos;
+    uint64_t elapsedTicks = now() - startTicks;
+    millisPerTick = elapsedTicks > 0 ? elapsedNanos / 1e6 / elapsedTicks : 1e-6;
+#else
+    millisPerTick = 1e-6; // ticks are nanoseconds
+#endif
+}
+
+uint64_t PipelineStats::now() {
+#ifdef PIPELINESTATS_USE_TSC
+    return __rdtsc();
+#else
+    return steadyNanos();
+#endif
+}
+
+void PipelineStats::record(Stage stage, uint64_t start) {
+    uint64_t end = now();
+    push(stage, end > start ? end - start : 0);
+}
+
+void PipelineStats::recordMillis(Stage stage, double ms) {
+    push(stage, ms > 0 ? static_cast<uint64_t>(ms / millisPerTick) : 0);
+}
+
+void PipelineStats::push(Stage stage, uint64_t ticks) {
+    Ring& ring = rings[stage];
+    // single writer per stage, so a plain load/store pair is enough
+    uint64_t count = ring.count.load(std::memory_order_relaxed);
+    ring.samples[count & (kWindow - 1)].store(ticks, std::memory_order_relaxed);
+    ring.count.store(count + 1, std::memory_order_release);
+}
+
+PipelineStats::Summary PipelineStats::summarize(Stage stage) const {
+    const Ring& ring = rings[stage];
+    uint64_t count = ring.count.load(std::memory_order_acquire);
+    int samples = static_cast<int>(std::min<uint64_t>(count, kWindow));
+    Summary summary = { samples, 0, 0, 0 };
+    if (samples == 0) return summary;
+
+    std::vector<uint64_t> sorted(samples);
+    for (int i = 0; i < samples; i++) {
+        sorted[i] = ring.samples[i].load(std::memory_order_relaxed);
+    }
+    size_t p50 = sorted.size() / 2;
+    size_t p99 = std::min(sorted.size() - 1, sorted.size() * 99 / 100);
+    std::nth_element(sorted.begin(), sorted.begin() + p50, sorted.end());
+    summary.p50 = sorted[p50] * millisPerTick;
+    std::nth_element(sorted.begin() + p50, sorted.begin() + p99, sorted.end());
+    summary.p99 = sorted[p99] * millisPerTick;
+    summary.max = *std::max_element(sorted.begin() + p99, sorted.end()) * millisPerTick;
+    return summary;
+}
+
+std::string PipelineStats::getStageName(Stage stage) {
+    switch (stage) {
+        case TIMER_DISPATCH: return "timer";
+        case COMPUTE:        return "compute";
+        case HISTORY_PUSH:   return "history";
+        case AGE_UPDATE:     return "ages";
+        case DRAW:           return "draw";
+        case REPAINT:        return "repaint";
+        default:             return "?";
+    }
+}
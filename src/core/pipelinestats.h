@@ -0,0 +1,86 @@
+/**
+ * File: pipelinestats.h
+ * ---------------------
+ * Defines cheap, always-on timing of the stages a generation goes through on
+ * its way to the screen. Each stage keeps its most recent durations in a
+ * small ring that only the thread running that stage writes to, so recording
+ * a sample is a timestamp read and two relaxed atomic stores: no locks, no
+ * allocation. Any thread may read percentiles from the rings at any time.
+ *
+ * Timestamps come from the CPU's time stamp counter where there is one
+ * (x86), calibrated against steady_clock once at construction, and from
+ * steady_clock elsewhere.
+ */
+
+#pragma once
+#include <atomic>  // for std::atomic
+#include <cstdint> // for uint64_t
+#include <string>  // for std::string
+
+class PipelineStats {
+public:
+    enum Stage {
+        TIMER_DISPATCH, // how late the presentation timer fired
+        COMPUTE,        // engine step for one generation
+        HISTORY_PUSH,   // copying the previous generation onto the undo stack
+        AGE_UPDATE,     // bringing the display's ages, age pyramid and cell ovals up to date
+        DRAW,           // shading the pixel buffer when zoomed out
+        REPAINT,        // handing the frame to the window system
+        kNumStages
+    };
+
+/**
+ * Summary of the recent samples of one stage, in milliseconds.
+ */
+    struct Summary {
+        int samples;
+        double p50;
+        double p99;
+        double max;
+    };
+
+/**
+ * Constructs empty rings and calibrates the time stamp counter, which takes
+ * a few milliseconds.
+ */
+    PipelineStats();
+
+/**
+ * Returns a timestamp in ticks for use with record.
+ */
+    static uint64_t now();
+
+/**
+ * Records that the given stage took from start (a value of now()) until now.
+ * Only one thread may record any given stage.
+ */
+    void record(Stage stage, uint64_t start);
+
+/**
+ * Records a duration given directly in milliseconds.
+ */
+    void recordMillis(Stage stage, double ms);
+
+/**
+ * Returns percentiles over the most recent kWindow samples of the stage.
+ */
+    Summary summarize(Stage stage) const;
+
+/**
+ * Returns a short label for the stage, e.g. "compute".
+ */
+    static std::string getStageName(Stage stage);
+
+private:
+    static const int kWindow = 256; // samples kept per stage; a power of two
+
+    struct Ring {
+        std::atomic<uint64_t> samples[kWindow]; // in ticks
+        std::atomic<uint64_t> count;            // samples ever recorded
+    };
+
+    void push(Stage stage, uint64_t ticks);
+
+    Ring rings[kNumStages];
+    double millisPerTick;
+};
@@ -0,0 +1,262 @@
+/**
+ * File: quadtree.cpp
+ * ------------------
+ * Implementation of the hash-consed quadtree.
+ */
+
+#include <algorithm>  // for min, max
+#include <functional> // for std::function
+#include <limits>     // for numeric_limits
+#include <stdexcept>  // for invalid_argument
+#include <string>     // for to_string
+
+#include "quadtree.h"
+
+namespace {
+// Adds populations, sticking at the largest value rather than wrapping.
+uint64_t addPopulations(uint64_t a, uint64_t b) {
+    uint64_t sum = a + b;
+    return sum < a ? std::numeric_limits<uint64_t>::max() : sum;
+}
+
+int countBits(uint64_t bits) {
+    int count = 0;
+    while (bits != 0) {
+        bits &= bits - 1;
+        count++;
+    }
+    return count;
+}
+
+struct Bounds {
+    bool known;
+    bool empty;
+    long long top, left, bottom, right; // inclusive, relative to the node's corner
+};
+}
+
+const Quadtree::NodeId Quadtree::kEmpty;
+const int Quadtree::kLeafLevel;
+const int Quadtree::kMaxLevel;
+
+size_t Quadtree::KeyHash::operator()(const Key& key) const {
+    uint64_t hash = static_cast<uint64_t>(key.level) * 0x9e3779b97f4a7c15ULL;
+    hash ^= key.first + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    hash ^= key.second + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+Quadtree::Quadtree() :
+    root(kEmpty), rootLevel(kLeafLevel) {
+    Node empty = { -1, { kEmpty, kEmpty, kEmpty, kEmpty }, 0, 0 };
+    nodes.push_back(empty);
+}
+
+Quadtree::NodeId Quadtree::makeLeaf(uint64_t cells) {
+    if (cells == 0) return kEmpty;
+    Key key = { kLeafLevel, cells, 0 };
+    Node node = { kLeafLevel, { kEmpty, kEmpty, kEmpty, kEmpty }, cells, static_cast<uint64_t>(countBits(cells)) };
+    return intern(key, node);
+}
+
+Quadtree::NodeId Quadtree::makeNode(int level, NodeId nw, NodeId ne, NodeId sw, NodeId se) {
+    if (level <= kLeafLevel || level > kMaxLevel) {
+        throw std::invalid_argument("Quadtree::makeNode: bad level " + std::to_string(level));
+    }
+    NodeId children[4] = { nw, ne, sw, se };
+    uint64_t population = 0;
+    for (NodeId child : children) {
+        if (child < 0 || child >= static_cast<NodeId>(nodes.size())
+                || (child != kEmpty && nodes[child].level != level - 1)) {
+            throw std::invalid_argument("Quadtree::makeNode: quadrant is not a level "
+                                        + std::to_string(level - 1) + " node");
+        }
+        population = addPopulations(population, nodes[child].population);
+    }
+    if (population == 0) return kEmpty;
+    Key key = { level,
+                static_cast<uint64_t>(static_cast<uint32_t>(nw)) << 32 | static_cast<uint32_t>(ne),
+                static_cast<uint64_t>(static_cast<uint32_t>(sw)) << 32 | static_cast<uint32_t>(se) };
+    Node node = { level, { nw, ne, sw, se }, 0, population };
+    return intern(key, node);
+}
+
+Quadtree::NodeId Quadtree::intern(const Key& key, const Node& node) {
+    auto found = index.find(key);
+    if (found != index.end()) return found->second;
+    NodeId id = static_cast<NodeId>(nodes.size());
+    nodes.push_back(node);
+    index.insert(std::make_pair(key, id));
+    return id;
+}
+
+Quadtree::NodeId Quadtree::getRoot() const {
+    return root;
+}
+
+int Quadtree::getRootLevel() const {
+    return rootLevel;
+}
+
+void Quadtree::setRoot(NodeId root, int level) {
+    if (level < kLeafLevel || level > kMaxLevel || (root != kEmpty && nodes[root].level != level)) {
+        throw std::invalid_argument("Quadtree::setRoot: root is not a level " + std::to_string(level) + " node");
+    }
+    this->root = root;
+    rootLevel = level;
+}
+
+int Quadtree::getLevel(NodeId node) const {
+    return nodes[node].level;
+}
+
+Quadtree::NodeId Quadtree::getChild(NodeId node, int quadrant) const {
+    return nodes[node].children[quadrant];
+}
+
+uint64_t Quadtree::getLeafCells(NodeId node) const {
+    return nodes[node].cells;
+}
+
+uint64_t Quadtree::getPopulation(NodeId node) const {
+    return nodes[node].population;
+}
+
+uint64_t Quadtree::getPopulation() const {
+    return nodes[root].population;
+}
+
+int Quadtree::getNodeCount() const {
+    return static_cast<int>(nodes.size()) - 1;
+}
+
+void Quadtree::fromGrid(const SimulationGrid& grid) {
+    nodes.resize(1);
+    index.clear();
+    // the board is centred as Golly centres bounded grids, so the root must cover an even side
+    int side = std::max(grid.getNumRows(), grid.getNumCols());
+    int level = kLeafLevel;
+    while ((1LL << level) < side + side % 2) {
+        level++;
+    }
+    root = buildFromGrid(grid, level, -getBoardOffset(level, grid.getNumRows()),
+                         -getBoardOffset(level, grid.getNumCols()));
+    rootLevel = level;
+}
+
+long long Quadtree::getBoardOffset(int rootLevel, int side) {
+    long long half = rootLevel > 0 ? 1LL << (rootLevel - 1) : 0;
+    return half - side / 2;
+}
+
+Quadtree::NodeId Quadtree::buildFromGrid(const SimulationGrid& grid, int level, long long top, long long left) {
+    long long size = 1LL << level;
+    if (top >= grid.getNumRows() || left >= grid.getNumCols() || top + size <= 0 || left + size <= 0) {
+        return kEmpty;
+    }
+    if (level == kLeafLevel) {
+        uint64_t cells = 0;
+        int endRow = static_cast<int>(std::min<long long>(top + 8, grid.getNumRows()));
+        int endCol = static_cast<int>(std::min<long long>(left + 8, grid.getNumCols()));
+        for (int i = static_cast<int>(std::max(top, 0LL)); i < endRow; i++) {
+            const int* row = grid.getGrid()[i];
+            for (int j = static_cast<int>(std::max(left, 0LL)); j < endCol; j++) {
+                if (row[j] != 0) cells |= 1ULL << ((i - top) * 8 + (j - left));
+            }
+        }
+        return makeLeaf(cells);
+    }
+    long long half = size / 2;
+    NodeId nw = buildFromGrid(grid, level - 1, top, left);
+    NodeId ne = buildFromGrid(grid, level - 1, top, left + half);
+    NodeId sw = buildFromGrid(grid, level - 1, top + half, left);
+    NodeId se = buildFromGrid(grid, level - 1, top + half, left + half);
+    return makeNode(level, nw, ne, sw, se);
+}
+
+bool Quadtree::getBounds(long long& top, long long& left, long long& bottom, long long& right) const {
+    std::vector<Bounds> memo(nodes.size(), Bounds());
+    std::function<const Bounds&(NodeId)> bounds = [&](NodeId id) -> const Bounds& {
+        Bounds& result = memo[id];
+        if (result.known) return result;
+        result.known = true;
+        result.empty = true;
+        const Node& node = nodes[id];
+        if (id == kEmpty) return result;
+        if (node.level == kLeafLevel) {
+            result.empty = false;
+            result.top = result.left = 7;
+            result.bottom = result.right = 0;
+            for (int bit = 0; bit < 64; bit++) {
+                if (node.cells & (1ULL << bit)) {
+                    result.top = std::min<long long>(result.top, bit / 8);
+                    result.bottom = std::max<long long>(result.bottom, bit / 8);
+                    result.left = std::min<long long>(result.left, bit % 8);
+                    result.right = std::max<long long>(result.right, bit % 8);
+                }
+            }
+            return result;
+        }
+        long long half = 1LL << (node.level - 1);
+        for (int quadrant = 0; quadrant < 4; quadrant++) {
+            const Bounds& child = bounds(node.children[quadrant]);
+            if (child.empty) continue;
+            long long rowOffset = quadrant >= 2 ? half : 0;
+            long long colOffset = quadrant % 2 == 1 ? half : 0;
+            Bounds& self = result; // memo is never resized, so result stays valid
+            if (self.empty) {
+                self.empty = false;
+                self.top = child.top + rowOffset;
+                self.bottom = child.bottom + rowOffset;
+                self.left = child.left + colOffset;
+                self.right = child.right + colOffset;
+            }
+            else {
+                self.top = std::min(self.top, child.top + rowOffset);
+                self.bottom = std::max(self.bottom, child.bottom + rowOffset);
+                self.left = std::min(self.left, child.left + colOffset);
+                self.right = std::max(self.right, child.right + colOffset);
+            }
+        }
+        return result;
+    };
+    const Bounds& result = bounds(root);
+    if (result.empty) return false;
+    top = result.top;
+    left = result.left;
+    bottom = result.bottom;
+    right = result.right;
+    return true;
+}
+
+void Quadtree::toGrid(SimulationGrid& grid, long long top, long long left, int numRows, int numCols) const {
+    grid.setGridFieldsEmpty(numRows, numCols);
+    paint(grid, root, 0, 0, top, left);
+}
+
+void Quadtree::paint(SimulationGrid& grid, NodeId id, long long nodeTop, long long nodeLeft,
+                     long long top, long long left) const {
+    if (id == kEmpty) return;
+    const Node& node = nodes[id];
+    long long size = 1LL << node.level;
+    if (nodeTop + size <= top || nodeTop >= top + grid.getNumRows()
+            || nodeLeft + size <= left || nodeLeft >= left + grid.getNumCols()) {
+        return; // entirely outside the area
+    }
+    if (node.level == kLeafLevel) {
+        for (int bit = 0; bit < 64; bit++) {
+            if (!(node.cells & (1ULL << bit))) continue;
+            long long row = nodeTop + bit / 8 - top;
+            long long col = nodeLeft + bit % 8 - left;
+            if (row >= 0 && row < grid.getNumRows() && col >= 0 && col < grid.getNumCols()) {
+                grid.getGrid()[row][col] = 1;
+            }
+        }
+        return;
+    }
+    long long half = size / 2;
+    paint(grid, node.children[0], nodeTop, nodeLeft, top, left);
+    paint(grid, node.children[1], nodeTop, nodeLeft + half, top, left);
+    paint(grid, node.children[2], nodeTop + half, nodeLeft, top, left);
+    paint(grid, node.children[3], nodeTop + half, nodeLeft + half, top, left);
+}
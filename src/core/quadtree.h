@@ -0,0 +1,145 @@
+/**
+ * File: quadtree.h
+ * ----------------
+ * Defines a hash-consed quadtree of live cells, the representation used by
+ * the macrocell (.mc) file format. A node of level k covers a 2^k by 2^k
+ * square and is made of four nodes of level k - 1; level 3 nodes are 8x8
+ * leaves holding their cells as bits. Identical subtrees are stored once,
+ * so patterns that repeat themselves (breeders, metacells) take space in
+ * proportion to their number of distinct pieces, not their area.
+ *
+ * Nodes are named by NodeId. Id 0 is the empty square of every level.
+ * Building a node that already exists returns the existing id.
+ */
+
+#pragma once
+#include <cstdint>       // for uint64_t
+#include <unordered_map> // for std::unordered_map
+#include <vector>        // for std::vector
+
+#include "simulationgrid.h"
+
+class Quadtree {
+public:
+    typedef int NodeId;
+
+    static const NodeId kEmpty = 0;
+    static const int kLeafLevel = 3;  // leaves are 8x8
+    static const int kMaxLevel = 62; // so that coordinates fit in a long long
+
+/**
+ * Constructs a tree whose root is the empty node.
+ */
+    Quadtree();
+
+/**
+ * Returns the leaf with the given cells: bit 8 * row + column is set for
+ * each live cell, row 0 being the top.
+ */
+    NodeId makeLeaf(uint64_t cells);
+
+/**
+ * Returns the node of the given level (above kLeafLevel) with the given
+ * quadrants, which must all be of level - 1 or empty. Throws
+ * std::invalid_argument if they are not.
+ */
+    NodeId makeNode(int level, NodeId nw, NodeId ne, NodeId sw, NodeId se);
+
+/**
+ * The root covers the whole universe, with the first row and column at its
+ * top left corner.
+ */
+    NodeId getRoot() const;
+    int getRootLevel() const;
+    void setRoot(NodeId root, int level);
+
+/**
+ * Returns a node's level; the empty node has none and returns -1.
+ */
+    int getLevel(NodeId node) const;
+
+/**
+ * Returns one quadrant of a node above leaf level: 0 nw, 1 ne, 2 sw, 3 se.
+ * Returns kEmpty for the empty node.
+ */
+    NodeId getChild(NodeId node, int quadrant) const;
+
+/**
+ * Returns a leaf's cells as described for makeLeaf, or 0 for the empty node.
+ */
+    uint64_t getLeafCells(NodeId node) const;
+
+/**
+ * Returns the number of live cells under a node, or under the root.
+ * Saturates at the largest uint64_t.
+ */
+    uint64_t getPopulation(NodeId node) const;
+    uint64_t getPopulation() const;
+
+/**
+ * Returns the number of distinct non-empty nodes in the tree so far,
+ * including any no longer reachable from the root.
+ */
+    int getNodeCount() const;
+
+/**
+ * Replaces the tree with the live cells of grid, centred in the smallest
+ * root that holds the whole board: its first row and column are
+ * getBoardOffset cells from the root's top left, as Golly places bounded
+ * grids.
+ */
+    void fromGrid(const SimulationGrid& grid);
+
+/**
+ * Returns how far from the top (or left) of a root of the given level a
+ * board with the given number of rows (or columns) starts when centred as
+ * Golly centres bounded grids: half the board before the root's middle,
+ * rounding down. Negative if the board is wider than the root.
+ */
+    static long long getBoardOffset(int rootLevel, int side);
+
+/**
+ * Finds the smallest rectangle holding every live cell under the root,
+ * in cell coordinates from the root's top left corner. Returns false if
+ * there are no live cells. Takes time in proportion to the number of nodes.
+ */
+    bool getBounds(long long& top, long long& left, long long& bottom, long long& right) const;
+
+/**
+ * Writes the cells of the given rows and columns into grid, replacing its
+ * contents; live cells get age 1. The area must be small enough for a
+ * SimulationGrid.
+ */
+    void toGrid(SimulationGrid& grid, long long top, long long left, int numRows, int numCols) const;
+
+private:
+    struct Node {
+        int level;
+        NodeId children[4];
+        uint64_t cells; // leaves only
+        uint64_t population;
+    };
+
+    struct Key {
+        int level;
+        uint64_t first;  // a leaf's cells, or its nw and ne quadrants
+        uint64_t second; // sw and se quadrants
+        bool operator==(const Key& other) const {
+            return level == other.level && first == other.first && second == other.second;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    std::vector<Node> nodes; // nodes[0] stands in for the empty node
+    std::unordered_map<Key, NodeId, KeyHash> index;
+    NodeId root;
+    int rootLevel;
+
+    NodeId intern(const Key& key, const Node& node);
+    NodeId buildFromGrid(const SimulationGrid& grid, int level, long long top, long long left);
+    void paint(SimulationGrid& grid, NodeId node, long long nodeTop, long long nodeLeft,
+               long long top, long long left) const;
+};
@@ -0,0 +1,434 @@
+/**
+ * File: recording.cpp
+ * -------------------
+ * Implementation of recording writing (on a background thread) and playback.
+ */
+
+#include <algorithm> // for min, max, fill
+#include <cstdio>    // for rename, remove
+#include <cstring>   // for memcmp, memcpy
+#include <stdexcept> // for runtime_error, out_of_range
+
+#include "recording.h"
+#include "life-constants.h" // for kMaxAge
+#include "logger.h"
+#include "tracing.h"
+
+namespace {
+
+const char kMagic[8] = { 'L', 'I', 'F', 'E', 'R', 'E', 'C', '\0' };
+const char kIndexMagic[8] = { 'L', 'I', 'F', 'E', 'I', 'D', 'X', '\0' };
+const size_t kHeaderSize = 24;
+const size_t kTrailerSize = 16;
+const size_t kIndexEntrySize = 16;
+const unsigned char kDelta = 0;
+const unsigned char kKeyframe = 1;
+const uint64_t kKeyframeBit = 1ULL << 63;
+// record() waits for the disk only once this many bytes of boards are queued
+const size_t kMaxQueuedBytes = 256 << 20;
+
+void put32(unsigned char* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+void put64(unsigned char* out, uint64_t value) {
+    for (int i = 0; i < 8; i++) out[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+uint32_t get32(const unsigned char* in) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; i--) value = (value << 8) | in[i];
+    return value;
+}
+
+uint64_t get64(const unsigned char* in) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) value = (value << 8) | in[i];
+    return value;
+}
+
+void putVarint(std::vector<unsigned char>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+// Reads a varint at in, advancing it; returns false if it runs past end.
+bool getVarint(const unsigned char*& in, const unsigned char* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && in < end; shift += 7) {
+        unsigned char byte = *in++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+size_t wordsFor(int numRows, int numCols) {
+    return (static_cast<size_t>(numRows) * numCols + 63) / 64;
+}
+
+int countTrailingZeros(uint64_t word) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int count = 0;
+    while ((word & 1) == 0) {
+        word >>= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+// Index of the first set bit at or after from in words (xor mask, if
+// flipped), or limit if there is none.
+uint64_t nextBit(const uint64_t* words, uint64_t from, uint64_t limit, uint64_t mask) {
+    if (from >= limit) return limit;
+    size_t w = static_cast<size_t>(from >> 6);
+    uint64_t word = (words[w] ^ mask) & (~0ULL << (from & 63));
+    size_t numWords = static_cast<size_t>((limit + 63) >> 6);
+    while (word == 0) {
+        if (++w == numWords) return limit;
+        word = words[w] ^ mask;
+    }
+    return std::min(limit, (static_cast<uint64_t>(w) << 6) + countTrailingZeros(word));
+}
+
+// Lists the runs of set bits in words as (skip, length) varint pairs.
+void encodeRuns(const uint64_t* words, uint64_t numCells, std::vector<unsigned char>& out) {
+    uint64_t position = 0;
+    while (true) {
+        uint64_t start = nextBit(words, position, numCells, 0);
+        if (start == numCells) return;
+        uint64_t end = nextBit(words, start, numCells, ~0ULL);
+        putVarint(out, start - position);
+        putVarint(out, end - start);
+        position = end;
+    }
+}
+
+// Flips the runs listed in a payload; returns false if it is malformed.
+bool applyRuns(const unsigned char* in, const unsigned char* end, uint64_t numCells, uint64_t* words) {
+    uint64_t position = 0;
+    while (in < end) {
+        uint64_t skip, length;
+        if (!getVarint(in, end, skip) || !getVarint(in, end, length)) return false;
+        if (skip > numCells - position || length > numCells - position - skip) return false;
+        position += skip;
+        for (uint64_t last = position + length; position < last; ) {
+            uint64_t bit = position & 63;
+            uint64_t count = std::min<uint64_t>(64 - bit, last - position);
+            uint64_t mask = (count == 64 ? ~0ULL : ((1ULL << count) - 1)) << bit;
+            words[position >> 6] ^= mask;
+            position += count;
+        }
+    }
+    return true;
+}
+}
+
+Recorder::Recorder(const std::string& filename, int numRows, int numCols, int interval, int keyframeInterval) :
+    filename(filename), temporary(filename + ".tmp"), numRows(numRows), numCols(numCols),
+    interval(std::max(interval, 1)), keyframeInterval(std::max(keyframeInterval, 1)), frameCount(0), closed(false),
+    stopping(false),
+    file(nullptr), offset(0), failed(false), previous(wordsFor(numRows, numCols), 0), framesSinceKeyframe(0) {
+    if (numRows <= 0 || numCols <= 0) {
+        throw std::invalid_argument("Recorder: bad dimensions");
+    }
+    file = std::fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Recorder: cannot create \"" + temporary + "\"");
+    }
+    std::vector<unsigned char> header(kHeaderSize, 0);
+    std::memcpy(header.data(), kMagic, sizeof(kMagic));
+    put32(header.data() + 8, kRecordingVersion);
+    put32(header.data() + 12, static_cast<uint32_t>(numRows));
+    put32(header.data() + 16, static_cast<uint32_t>(numCols));
+    writeBytes(header);
+    thread = std::thread(&Recorder::run, this);
+}
+
+Recorder::~Recorder() {
+    close();
+}
+
+void Recorder::record(const SimulationGrid& grid, long long generation) {
+    if (closed || generation % interval != 0) return;
+    if (grid.getNumRows() != numRows || grid.getNumCols() != numCols) {
+        throw std::invalid_argument("Recorder: board size changed");
+    }
+    Pending frame;
+    frame.generation = generation;
+    {
+        TRACE_SPAN("record frame");
+        frame.cells.assign(wordsFor(numRows, numCols), 0);
+        uint64_t* words = frame.cells.data();
+        uint64_t cell = 0;
+        for (int i = 0; i < numRows; i++) {
+            const int* row = grid.getGrid()[i];
+            for (int j = 0; j < numCols; j++, cell++) {
+                words[cell >> 6] |= static_cast<uint64_t>(row[j] != 0) << (cell & 63); // no branch on random boards
+            }
+        }
+    }
+    size_t frameBytes = frame.cells.size() * sizeof(uint64_t);
+    size_t maxQueued = std::max<size_t>(1, kMaxQueuedBytes / std::max<size_t>(frameBytes, 1));
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeup.wait(lock, [this, maxQueued] { return queue.size() < maxQueued; });
+        queue.push_back(std::move(frame));
+    }
+    wakeup.notify_all();
+    frameCount++;
+}
+
+void Recorder::close() {
+    if (closed) return;
+    closed = true;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    thread.join();
+
+    // the index, so playback can find every frame without reading them all
+    std::vector<unsigned char> footer(8 + index.size() * kIndexEntrySize + kTrailerSize);
+    unsigned char* out = footer.data();
+    put64(out, index.size());
+    out += 8;
+    for (const IndexEntry& entry : index) {
+        put64(out, static_cast<uint64_t>(entry.generation));
+        put64(out + 8, entry.offset | (entry.keyframe ? kKeyframeBit : 0));
+        out += kIndexEntrySize;
+    }
+    put64(out, offset);
+    std::memcpy(out + 8, kIndexMagic, sizeof(kIndexMagic));
+    writeBytes(footer);
+    if (std::fclose(file) != 0 && !failed) {
+        failed = true;
+        LOG_ERROR("recording to " << filename << " failed on close");
+    }
+    file = nullptr;
+    // renamed over the file name only now, as snapshots are, so that a
+    // recording of the same name being played back is never truncated
+#ifdef _WIN32
+    std::remove(filename.c_str()); // rename does not replace files on Windows
+#endif
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+        failed = true;
+        LOG_ERROR("cannot replace " << filename << "; the recording is left in " << temporary);
+    }
+    if (!failed) {
+        LOG_INFO("recorded " << index.size() << " frames to " << filename);
+    }
+}
+
+long long Recorder::getFrameCount() const {
+    return frameCount;
+}
+
+void Recorder::run() {
+    Tracer::setThreadName("recorder");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wakeup.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) return; // stopping, and everything is written
+        Pending frame = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        wakeup.notify_all(); // record may be waiting for room
+        writeFrame(frame);
+        lock.lock();
+    }
+}
+
+void Recorder::writeFrame(const Pending& frame) {
+    TRACE_SPAN("write frame");
+    bool keyframe = framesSinceKeyframe == 0;
+    framesSinceKeyframe = (framesSinceKeyframe + 1) % keyframeInterval;
+
+    // a keyframe is the delta from an empty board
+    std::vector<uint64_t> changes(frame.cells);
+    if (!keyframe) {
+        for (size_t w = 0; w < changes.size(); w++) changes[w] ^= previous[w];
+    }
+    std::vector<unsigned char> payload;
+    encodeRuns(changes.data(), static_cast<uint64_t>(numRows) * numCols, payload);
+    previous = frame.cells;
+
+    std::vector<unsigned char> bytes;
+    bytes.push_back(keyframe ? kKeyframe : kDelta);
+    putVarint(bytes, static_cast<uint64_t>(frame.generation));
+    putVarint(bytes, payload.size());
+    bytes.insert(bytes.end(), payload.begin(), payload.end());
+    index.push_back({frame.generation, offset, keyframe});
+    writeBytes(bytes);
+}
+
+void Recorder::writeBytes(const std::vector<unsigned char>& bytes) {
+    if (failed) return;
+    if (std::fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size()) {
+        failed = true;
+        LOG_ERROR("recording to " << filename << " failed; later frames are lost");
+        return;
+    }
+    offset += bytes.size();
+}
+
+RecordingReader::RecordingReader(const std::string& filename) :
+    file(new MappedFile(filename)), numRows(0), numCols(0), cellsFrame(-1), agesFrame(-1) {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(file->getData());
+    if (file->getSize() < kHeaderSize || std::memcmp(data, kMagic, sizeof(kMagic)) != 0) {
+        throw std::runtime_error("RecordingReader: \"" + filename + "\" is not a recording");
+    }
+    uint32_t version = get32(data + 8);
+    if (version > kRecordingVersion) {
+        throw std::runtime_error("RecordingReader: recording version " + std::to_string(version)
+                                 + " is newer than this program");
+    }
+    numRows = static_cast<int>(get32(data + 12));
+    numCols = static_cast<int>(get32(data + 16));
+    if (numRows <= 0 || numCols <= 0) {
+        throw std::runtime_error("RecordingReader: bad dimensions");
+    }
+    readIndex();
+    if (frames.empty()) {
+        throw std::runtime_error("RecordingReader: \"" + filename + "\" has no frames");
+    }
+    cells.assign(wordsFor(numRows, numCols), 0);
+    ages.setGridFieldsEmpty(numRows, numCols);
+}
+
+int RecordingReader::getNumRows() const {
+    return numRows;
+}
+
+int RecordingReader::getNumCols() const {
+    return numCols;
+}
+
+int RecordingReader::getFrameCount() const {
+    return static_cast<int>(frames.size());
+}
+
+long long RecordingReader::getGeneration(int frame) const {
+    if (frame < 0 || frame >= getFrameCount()) {
+        throw std::out_of_range("RecordingReader: no frame " + std::to_string(frame));
+    }
+    return frames[frame].generation;
+}
+
+void RecordingReader::readFrame(int frame, SimulationGrid& grid) {
+    if (frame < 0 || frame >= getFrameCount()) {
+        throw std::out_of_range("RecordingReader: no frame " + std::to_string(frame));
+    }
+    TRACE_SPAN("read frame");
+    if (frame != agesFrame && frame != agesFrame + 1) {
+        // Jump: ages can only tell the last kMaxAge frames apart, so rebuild
+        // them from there rather than from the start of the recording.
+        seekCells(std::max(frame - kMaxAge, 0));
+        for (int i = 0; i < numRows; i++) std::fill(ages.getGrid()[i], ages.getGrid()[i] + numCols, 0);
+        ageCells();
+    }
+    while (agesFrame < frame) {
+        seekCells(agesFrame + 1);
+        ageCells();
+    }
+    grid = ages;
+}
+
+void RecordingReader::seekCells(int frame) {
+    int keyframe = frame;
+    while (!frames[keyframe].keyframe) keyframe--;
+    if (cellsFrame > frame) {
+        // A delta undoes itself, so stepping back is as cheap as stepping
+        // forward, as long as no keyframe is crossed.
+        int back = cellsFrame - frame;
+        bool crossesKeyframe = false;
+        for (int f = frame + 1; f <= cellsFrame && !crossesKeyframe; f++) crossesKeyframe = frames[f].keyframe;
+        if (!crossesKeyframe && back <= frame - keyframe) {
+            for (; cellsFrame > frame; cellsFrame--) applyPayload(cellsFrame);
+            return;
+        }
+    }
+    if (cellsFrame < keyframe || cellsFrame > frame) {
+        std::fill(cells.begin(), cells.end(), 0);
+        applyPayload(keyframe);
+        cellsFrame = keyframe;
+    }
+    for (; cellsFrame < frame; cellsFrame++) applyPayload(cellsFrame + 1);
+}
+
+void RecordingReader::ageCells() {
+    // same ageing as the engines: survivors grow older, newborns start at 1
+    uint64_t cell = 0;
+    for (int i = 0; i < numRows; i++) {
+        int* row = ages.getGrid()[i];
+        for (int j = 0; j < numCols; j++, cell++) {
+            bool alive = (cells[cell >> 6] >> (cell & 63)) & 1;
+            row[j] = alive ? std::min(row[j] + 1, kMaxAge) : 0;
+        }
+    }
+    agesFrame = cellsFrame;
+}
+
+void RecordingReader::applyPayload(int frame) {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(file->getData());
+    const unsigned char* end = data + file->getSize();
+    const unsigned char* in = data + frames[frame].offset;
+    uint64_t generation, size;
+    in++; // kind, already in the index
+    if (!getVarint(in, end, generation) || !getVarint(in, end, size) || size > static_cast<uint64_t>(end - in)) {
+        throw std::runtime_error("RecordingReader: frame " + std::to_string(frame) + " is truncated");
+    }
+    if (!applyRuns(in, in + size, static_cast<uint64_t>(numRows) * numCols, cells.data())) {
+        throw std::runtime_error("RecordingReader: frame " + std::to_string(frame) + " is damaged");
+    }
+}
+
+void RecordingReader::readIndex() {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(file->getData());
+    size_t size = file->getSize();
+    if (size >= kHeaderSize + 8 + kTrailerSize
+        && std::memcmp(data + size - 8, kIndexMagic, sizeof(kIndexMagic)) == 0) {
+        uint64_t indexOffset = get64(data + size - kTrailerSize);
+        if (indexOffset >= kHeaderSize && indexOffset <= size - kTrailerSize - 8) {
+            uint64_t count = get64(data + indexOffset);
+            if (count == (size - kTrailerSize - 8 - indexOffset) / kIndexEntrySize) {
+                const unsigned char* in = data + indexOffset + 8;
+                for (uint64_t i = 0; i < count; i++, in += kIndexEntrySize) {
+                    uint64_t offset = get64(in + 8);
+                    frames.push_back({static_cast<long long>(get64(in)), offset & ~kKeyframeBit,
+                                      (offset & kKeyframeBit) != 0});
+                    if (frames.back().offset >= indexOffset) break;
+                }
+                if (frames.size() == count && (count == 0 || frames.front().keyframe)) return;
+            }
+        }
+        frames.clear();
+    }
+    LOG_WARNING("recording has no usable index; reading every frame header instead");
+    scanFrames();
+}
+
+void RecordingReader::scanFrames() {
+    // a recording that was never closed: walk the frames up to the first one
+    // cut short, or to where the index of a damaged one begins
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(file->getData());
+    const unsigned char* end = data + file->getSize();
+    const unsigned char* in = data + kHeaderSize;
+    while (in < end) {
+        const unsigned char* start = in;
+        unsigned char kind = *in++;
+        uint64_t generation, size;
+        if (kind > kKeyframe || !getVarint(in, end, generation) || !getVarint(in, end, size)
+            || size > static_cast<uint64_t>(end - in)) break;
+        if (frames.empty() && kind != kKeyframe) break;
+        frames.push_back({static_cast<long long>(generation), static_cast<uint64_t>(start - data), kind == kKeyframe});
+        in += size;
+    }
+}
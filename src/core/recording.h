@@ -0,0 +1,187 @@
+/**
+ * File: recording.h
+ * -----------------
+ * Defines recordings of a run: append-only files holding the board after
+ * every generation (or every Nth), which can be played back, forwards or
+ * backwards at any speed, without computing anything.
+ *
+ * A recording starts with a header, followed by one frame per recorded
+ * generation and, once the recording is closed, an index of the frames:
+ *
+ *    header   "LIFEREC" '\0', then version, rows and columns as 32-bit
+ *             little-endian integers and 4 reserved bytes
+ *    frame    one byte kind (0 delta, 1 keyframe), the generation and the
+ *             payload size as varints, then the payload
+ *    index    the number of frames as a 64-bit integer, then per frame its
+ *             generation and its file offset (top bit set for keyframes)
+ *    trailer  the index's file offset as a 64-bit integer, then "LIFEIDX" '\0'
+ *
+ * A payload lists runs of cells in row-major order as pairs of varints: the
+ * number of cells skipped since the previous run, then the length of the
+ * run. In a delta the runs are the cells that changed state since the
+ * previous frame; in a keyframe they are the live cells. Varints are
+ * little-endian base 128, seven bits to a byte, high bit set on all but the
+ * last. Keyframes are written every so often so that playback can jump
+ * anywhere without decoding from the start.
+ *
+ * Only liveness is recorded. On playback, cells age by one per frame, as in
+ * the simulation; after a jump, ages are rebuilt from the last kMaxAge
+ * frames, which is as far back as they can be told apart.
+ *
+ * A recording is written under a temporary name (the file name followed by
+ * ".tmp") and renamed over the file name only once it is closed, so a
+ * recording being played back is never truncated by a new one of the same
+ * name. If a recording was never closed (the program crashed, say), it is
+ * left under the temporary name with no index; the index is rebuilt by
+ * reading the frame headers, and a frame cut short at the end is ignored.
+ */
+
+#pragma once
+#include <condition_variable> // for std::condition_variable
+#include <cstdint>            // for uint64_t
+#include <cstdio>             // for FILE, fopen, fwrite
+#include <deque>              // for std::deque
+#include <memory>             // for std::unique_ptr
+#include <mutex>              // for std::mutex
+#include <string>             // for std::string
+#include <thread>             // for std::thread
+#include <vector>             // for std::vector
+
+#include "simulationgrid.h"
+#include "mappedfile.h"
+
+const unsigned int kRecordingVersion = 1;
+
+/*
+ * Writes a recording. record() only packs the board into bits and queues
+ * it; a background thread works out what changed, encodes it and writes it,
+ * so the caller never waits on the disk. All boards must have the size
+ * given to the constructor, and record() must always be called from the
+ * same thread. record() waits only if hundreds of megabytes of boards are
+ * already queued, so that a slow disk cannot exhaust memory.
+ */
+class Recorder {
+public:
+/**
+ * Starts a recording to be saved under the named file, creating (or
+ * truncating) its temporary file. Every interval-th generation is recorded,
+ * and every keyframeInterval-th recorded frame is a keyframe. Throws
+ * std::runtime_error if the file cannot be created.
+ */
+    Recorder(const std::string& filename, int numRows, int numCols, int interval = 1, int keyframeInterval = 256);
+
+/**
+ * Calls close.
+ */
+    ~Recorder();
+
+/**
+ * Queues the board for writing if generation is a multiple of the interval.
+ */
+    void record(const SimulationGrid& grid, long long generation);
+
+/**
+ * Writes everything still queued and the index, closes the file and
+ * renames it over the file name. Waits for the disk. Later calls to record
+ * are ignored.
+ */
+    void close();
+
+/**
+ * Returns the number of frames queued so far.
+ */
+    long long getFrameCount() const;
+
+private:
+    struct Pending {
+        long long generation;
+        std::vector<uint64_t> cells; // one bit per cell, row-major
+    };
+
+    struct IndexEntry {
+        long long generation;
+        uint64_t offset;
+        bool keyframe;
+    };
+
+    void run();
+    void writeFrame(const Pending& frame);
+    void writeBytes(const std::vector<unsigned char>& bytes);
+
+    std::string filename;
+    std::string temporary; // written to until close
+    int numRows;
+    int numCols;
+    int interval;
+    int keyframeInterval;
+    long long frameCount;
+    bool closed;
+
+    std::thread thread;
+    std::mutex mutex; // guards queue and stopping
+    std::condition_variable wakeup;
+    std::deque<Pending> queue;
+    bool stopping;
+
+    // owned by the writer thread
+    FILE* file;
+    uint64_t offset;
+    bool failed;
+    std::vector<uint64_t> previous;
+    std::vector<IndexEntry> index;
+    int framesSinceKeyframe;
+
+    Recorder(const Recorder&) = delete;
+    Recorder& operator=(const Recorder&) = delete;
+};
+
+/*
+ * Plays back a recording. Frames can be read in any order; reading the
+ * frame after the last one read costs only its delta, and reading the one
+ * before it a few dozen.
+ */
+class RecordingReader {
+public:
+/**
+ * Opens the named recording. Throws std::runtime_error if it cannot be
+ * read or is not a recording.
+ */
+    explicit RecordingReader(const std::string& filename);
+
+    int getNumRows() const;
+    int getNumCols() const;
+    int getFrameCount() const;
+
+/**
+ * Returns the generation the given frame was recorded at.
+ */
+    long long getGeneration(int frame) const;
+
+/**
+ * Writes the given frame into grid. Throws std::out_of_range for frames
+ * that do not exist and std::runtime_error if the file is damaged.
+ */
+    void readFrame(int frame, SimulationGrid& grid);
+
+private:
+    struct Entry {
+        long long generation;
+        uint64_t offset;
+        bool keyframe;
+    };
+
+    void readIndex();
+    void scanFrames();
+    void seekCells(int frame);
+    void ageCells();
+    void applyPayload(int frame);
+
+    std::unique_ptr<MappedFile> file;
+    int numRows;
+    int numCols;
+    std::vector<Entry> frames;
+    std::vector<uint64_t> cells; // liveness at cellsFrame, one bit per cell
+    SimulationGrid ages;          // ages at agesFrame
+    int cellsFrame;               // -1 before the first read
+    int agesFrame;
+};
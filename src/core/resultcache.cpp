@@ -0,0 +1,248 @@
+/**
+ * File: resultcache.cpp
+ * ---------------------
+ * Implementation of the on-disk cache of run results and its index.
+ */
+
+#include <algorithm> // for max
+#include <cerrno>    // for errno, EEXIST
+#include <cstdio>    // for rename, remove
+#include <fstream>   // for ifstream, ofstream
+#include <sstream>   // for istringstream, ostringstream
+#include <stdexcept> // for runtime_error
+#include <sys/stat.h> // for stat, mkdir
+#ifdef _WIN32
+#include <direct.h>   // for _mkdir
+#endif
+
+#include "resultcache.h"
+#include "snapshot.h"
+#include "logger.h"
+#include "tracing.h"
+
+namespace {
+
+const char kIndexHeader[] = "LIFECACHE";
+const char kIndexName[] = "index";
+const uint64_t kFnvOffset = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+void mixBytes(uint64_t& hash, uint64_t value, int numBytes) {
+    for (int i = 0; i < numBytes; i++) hash = (hash ^ ((value >> (8 * i)) & 0xff)) * kFnvPrime;
+}
+
+bool makeDirectory(const std::string& path) {
+#ifdef _WIN32
+    int result = _mkdir(path.c_str());
+#else
+    int result = mkdir(path.c_str(), 0755);
+#endif
+    return result == 0 || errno == EEXIST;
+}
+
+bool getFileSize(const std::string& path, long long& size) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return false;
+    size = static_cast<long long>(info.st_size);
+    return true;
+}
+
+std::string toHex(uint64_t value) {
+    std::ostringstream out;
+    out << std::hex << value;
+    return out.str();
+}
+}
+
+ResultCache::ResultCache(const std::string& directory, long long maxBytes) :
+    directory(directory), maxBytes(maxBytes), totalBytes(0), clock(0) {
+    if (directory.empty() || !makeDirectory(directory)) {
+        throw std::runtime_error("ResultCache: cannot create \"" + directory + "\"");
+    }
+    loadIndex();
+}
+
+uint64_t ResultCache::hashBoard(const SimulationGrid& grid) {
+    TRACE_SPAN("hash board");
+    uint64_t hash = kFnvOffset;
+    mixBytes(hash, static_cast<uint64_t>(grid.getNumRows()), 4);
+    mixBytes(hash, static_cast<uint64_t>(grid.getNumCols()), 4);
+    for (int i = 0; i < grid.getNumRows(); i++) {
+        const int* row = grid.getGrid()[i];
+        for (int j = 0; j < grid.getNumCols(); j++) {
+            hash = (hash ^ static_cast<unsigned char>(row[j])) * kFnvPrime;
+        }
+    }
+    return hash;
+}
+
+long long ResultCache::lookup(uint64_t boardHash, const LifeRule& rule, long long generations,
+                              SimulationGrid& grid) {
+    TRACE_SPAN("cache lookup");
+    std::string ruleText = rule.toString();
+    while (true) {
+        // the furthest entry for this board, rule and boundary not past generations
+        auto best = entries.end();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            const Entry& entry = it->second;
+            if (entry.boardHash == boardHash && entry.rule == ruleText && entry.boundary == kTorusBoundary
+                && entry.generations <= generations
+                && (best == entries.end() || entry.generations > best->second.generations)) {
+                best = it;
+            }
+        }
+        if (best == entries.end()) return -1;
+
+        try {
+            SimulationGrid found;
+            SnapshotInfo info;
+            readSnapshot(getEntryFilename(best->first), found, &info);
+            if (info.rule != rule || info.generation != best->second.generations) {
+                throw std::runtime_error("does not match its index entry");
+            }
+            grid.swap(found);
+            best->second.lastUsed = ++clock;
+            long long hit = best->second.generations;
+            saveIndex();
+            LOG_DEBUG("cache hit: " << hit << " of " << generations << " generations");
+            return hit;
+        }
+        catch (const std::exception& ex) {
+            // deleted or damaged behind the index's back; forget it and look again
+            LOG_WARNING("dropping cache entry " << getEntryFilename(best->first) << ": " << ex.what());
+            std::remove(getEntryFilename(best->first).c_str());
+            totalBytes -= best->second.size;
+            entries.erase(best);
+            saveIndex();
+        }
+    }
+}
+
+void ResultCache::store(uint64_t boardHash, const LifeRule& rule, long long generations,
+                        const SimulationGrid& grid) {
+    TRACE_SPAN("cache store");
+    Entry entry = { boardHash, rule.toString(), kTorusBoundary, generations, 0, ++clock };
+    uint64_t key = makeKey(boardHash, entry.rule, entry.boundary, generations);
+    std::string filename = getEntryFilename(key);
+    try {
+        SnapshotInfo info;
+        info.rule = rule;
+        info.generation = generations;
+        writeSnapshot(filename, grid, info);
+    }
+    catch (const std::exception& ex) {
+        LOG_WARNING("cannot cache result: " << ex.what());
+        return;
+    }
+    if (!getFileSize(filename, entry.size)) return;
+    if (entry.size > maxBytes) {
+        LOG_DEBUG("not caching " << filename << ": larger than the whole cache");
+        std::remove(filename.c_str());
+        return;
+    }
+    auto existing = entries.find(key);
+    if (existing != entries.end()) totalBytes -= existing->second.size;
+    entries[key] = entry;
+    totalBytes += entry.size;
+    evict();
+    saveIndex();
+}
+
+long long ResultCache::getSize() const {
+    return totalBytes;
+}
+
+uint64_t ResultCache::makeKey(uint64_t boardHash, const std::string& rule, const std::string& boundary,
+                              long long generations) {
+    uint64_t hash = kFnvOffset;
+    mixBytes(hash, boardHash, 8);
+    for (char c : rule) mixBytes(hash, static_cast<unsigned char>(c), 1);
+    mixBytes(hash, 0, 1); // so that no rule and boundary run together the same way as another pair
+    for (char c : boundary) mixBytes(hash, static_cast<unsigned char>(c), 1);
+    mixBytes(hash, 0, 1);
+    mixBytes(hash, static_cast<uint64_t>(generations), 8);
+    return hash;
+}
+
+std::string ResultCache::getEntryFilename(uint64_t key) const {
+    std::string name = toHex(key);
+    return directory + "/" + std::string(16 - name.size(), '0') + name + ".snap";
+}
+
+void ResultCache::evict() {
+    while (totalBytes > maxBytes && !entries.empty()) {
+        auto oldest = entries.begin();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->second.lastUsed < oldest->second.lastUsed) oldest = it;
+        }
+        LOG_DEBUG("evicting cache entry " << getEntryFilename(oldest->first));
+        std::remove(getEntryFilename(oldest->first).c_str());
+        totalBytes -= oldest->second.size;
+        entries.erase(oldest);
+    }
+}
+
+void ResultCache::loadIndex() {
+    std::string indexFile = directory + "/" + kIndexName;
+    std::ifstream input(indexFile);
+    if (!input) return; // a new cache
+    std::string line;
+    std::string expected = std::string(kIndexHeader) + " " + std::to_string(kResultCacheVersion);
+    if (!std::getline(input, line) || line != expected) {
+        LOG_WARNING("ignoring cache index " << indexFile << ": not a version " << kResultCacheVersion << " index");
+        return;
+    }
+    try {
+        while (std::getline(input, line)) {
+            std::istringstream fields(line);
+            std::string key, boardHash;
+            Entry entry;
+            if (!std::getline(fields, key, '\t') || !std::getline(fields, boardHash, '\t')
+                || !std::getline(fields, entry.rule, '\t') || !std::getline(fields, entry.boundary, '\t')
+                || !(fields >> entry.generations >> entry.size >> entry.lastUsed)) {
+                throw std::runtime_error("bad line \"" + line + "\"");
+            }
+            entry.boardHash = std::stoull(boardHash, nullptr, 16);
+            uint64_t parsedKey = std::stoull(key, nullptr, 16);
+            long long size;
+            if (!getFileSize(getEntryFilename(parsedKey), size) || size != entry.size) continue; // gone or replaced
+            entries[parsedKey] = entry;
+            totalBytes += entry.size;
+            clock = std::max(clock, entry.lastUsed);
+        }
+    }
+    catch (const std::exception& ex) {
+        LOG_WARNING("ignoring damaged cache index " << indexFile << ": " << ex.what());
+        entries.clear();
+        totalBytes = 0;
+    }
+    evict(); // in case the cap has shrunk
+}
+
+void ResultCache::saveIndex() const {
+    // written beside the old index and renamed over it, as snapshots are
+    std::string indexFile = directory + "/" + kIndexName;
+    std::string temporary = indexFile + ".tmp";
+    {
+        std::ofstream output(temporary, std::ios::trunc);
+        output << kIndexHeader << " " << kResultCacheVersion << '\n';
+        for (const auto& item : entries) {
+            const Entry& entry = item.second;
+            output << toHex(item.first) << '\t' << toHex(entry.boardHash) << '\t' << entry.rule << '\t'
+                   << entry.boundary << '\t' << entry.generations << '\t' << entry.size << '\t'
+                   << entry.lastUsed << '\n';
+        }
+        if (!output) {
+            std::remove(temporary.c_str());
+            LOG_WARNING("cannot write cache index " << temporary);
+            return;
+        }
+    }
+#ifdef _WIN32
+    std::remove(indexFile.c_str()); // rename does not replace files on Windows
+#endif
+    if (std::rename(temporary.c_str(), indexFile.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        LOG_WARNING("cannot replace cache index " << indexFile);
+    }
+}
@@ -0,0 +1,96 @@
+/**
+ * File: resultcache.h
+ * -------------------
+ * Defines a cache of run results on disk: the board a pattern becomes after
+ * a given number of generations, kept so that running the same pattern to
+ * the same generation again reads a file instead of simulating.
+ *
+ * Entries are addressed by content. An entry's key is a hash of the
+ * starting board (its size and every cell's age), the rule, the boundary
+ * mode and the number of generations run, and the entry itself is a
+ * snapshot (see snapshot.h) named after the key in the cache directory.
+ * Boards always wrap at their edges (see lifeengine.h), so the boundary mode
+ * is always kTorusBoundary for now; it is part of the key so that entries
+ * made under other modes would never be confused with these.
+ *
+ * The directory also holds a text index, "index", listing each entry's key
+ * fields, size and when it was last used. Once the entries take up more
+ * than the cache's size cap, the least recently used are deleted. A lookup
+ * finds the entry furthest along short of the generation asked for, so a
+ * longer run than before only simulates the generations past it.
+ *
+ * The cache is meant for one process, and one thread, at a time. A missing
+ * or damaged index or entry is only ever a miss.
+ */
+
+#pragma once
+#include <cstdint> // for uint64_t
+#include <map>     // for std::map
+#include <string>  // for std::string
+
+#include "simulationgrid.h"
+#include "liferule.h"
+
+const unsigned int kResultCacheVersion = 1;
+const long long kDefaultCacheBytes = 256LL << 20;
+const char kTorusBoundary[] = "torus";
+
+class ResultCache {
+public:
+/**
+ * Opens the cache in the named directory, creating the directory (but not
+ * its parents) if need be, and keeping its entries to at most maxBytes in
+ * all. Throws std::runtime_error if the directory cannot be created.
+ */
+    explicit ResultCache(const std::string& directory, long long maxBytes = kDefaultCacheBytes);
+
+/**
+ * Returns a hash of a starting board for lookup and store: of its size and
+ * every cell's age, since ages carry through to the result.
+ */
+    static uint64_t hashBoard(const SimulationGrid& grid);
+
+/**
+ * Looks for the board that the board hashing to boardHash becomes under
+ * rule after at most the given number of generations. On a hit, loads the
+ * furthest one found into grid and returns how many generations it is past
+ * the start; otherwise returns -1 and leaves grid alone.
+ */
+    long long lookup(uint64_t boardHash, const LifeRule& rule, long long generations, SimulationGrid& grid);
+
+/**
+ * Saves grid as the board that the board hashing to boardHash becomes under
+ * rule after the given number of generations, then deletes the least
+ * recently used entries until the cache fits its cap again. Failures are
+ * only logged.
+ */
+    void store(uint64_t boardHash, const LifeRule& rule, long long generations, const SimulationGrid& grid);
+
+/**
+ * Returns the total size in bytes of the entries.
+ */
+    long long getSize() const;
+
+private:
+    struct Entry {
+        uint64_t boardHash;
+        std::string rule;
+        std::string boundary;
+        long long generations;
+        long long size;     // of the snapshot, in bytes
+        long long lastUsed; // in uses of the cache; larger is more recent
+    };
+
+    static uint64_t makeKey(uint64_t boardHash, const std::string& rule, const std::string& boundary,
+                            long long generations);
+    std::string getEntryFilename(uint64_t key) const;
+    void evict();
+    void loadIndex();
+    void saveIndex() const;
+
+    std::string directory;
+    long long maxBytes;
+    std::map<uint64_t, Entry> entries; // by key
+    long long totalBytes;
+    long long clock; // the last use's number
+};
@@ -1,3 +1,5 @@
+#include <utility> // for std::swap
+
 #include "simulationgrid.h"
 
 SimulationGrid::SimulationGrid():
@@ -54,7 +56,7 @@ int** SimulationGrid::getGrid() const {
 
 void SimulationGrid::setGridFields(int numRows, int numCols, int **grid) {
     if (this->grid != nullptr) {
-        for (int i = 0; i < numRows; i++) {
+        for (int i = 0; i < this->numRows; i++) {
             delete[] this->grid[i];
         }
         delete[] this->grid;
@@ -65,25 +67,46 @@ void SimulationGrid::setGridFields(int numRows, int numCols, int **grid) {
 }
 
 void SimulationGrid::setGridFieldsEmpty(int numRows, int numCols) {
+    // allocate before touching the members, so that a failed allocation leaves this grid as it was
+    int** newGrid = new int*[numRows];
+    int allocated = 0;
+    try {
+        for (; allocated < numRows; allocated++) {
+            newGrid[allocated] = new int[numCols];
+            for (int j = 0; j < numCols; j++) {
+                newGrid[allocated][j] = 0;
+            }
+        }
+    }
+    catch (...) {
+        for (int i = 0; i < allocated; i++) {
+            delete[] newGrid[i];
+        }
+        delete[] newGrid;
+        throw;
+    }
     if (this->grid != nullptr) {
-        for (int i = 0; i < numRows; i++) {
+        for (int i = 0; i < this->numRows; i++) {
             delete[] this->grid[i];
         }
         delete[] this->grid;
     }
     this->numRows = numRows;
     this->numCols = numCols;
-    int** newGrid = new int*[numRows];
-    for (int i = 0; i < numRows; i++) {
-        newGrid[i] = new int[numCols];
-        for (int j = 0; j < numCols; j++) {
-            newGrid[i][j] = 0;
-        }
-    }
     grid = newGrid;
 }
 
 void SimulationGrid::operator =(const SimulationGrid& rhs) {
+    if (this == &rhs) return;
+    // same dimensions: copy into the rows we already own instead of reallocating
+    if (this->grid != nullptr && numRows == rhs.numRows && numCols == rhs.numCols) {
+        for (int i = 0; i < numRows; i++) {
+            for (int j = 0; j < numCols; j++) {
+                grid[i][j] = rhs.getGrid()[i][j];
+            }
+        }
+        return;
+    }
     if (this->grid != nullptr) {
         for (int i = 0; i < numRows; i++) {
             delete[] grid[i];
@@ -101,3 +124,48 @@ void SimulationGrid::operator =(const SimulationGrid& rhs) {
     }
     grid = otherGrid;
 }
+
+void SimulationGrid::swap(SimulationGrid& other) {
+    std::swap(numRows, other.numRows);
+    std::swap(numCols, other.numCols);
+    std::swap(grid, other.grid);
+}
+
+long long SimulationGrid::getPopulation() const {
+    long long population = 0;
+    for (int i = 0; i < numRows; i++) {
+        for (int j = 0; j < numCols; j++) {
+            if (grid[i][j] != 0) population++;
+        }
+    }
+    return population;
+}
+
+unsigned long long SimulationGrid::getHash() const {
+    // 64-bit FNV-1a over the dimensions and one bit per cell, eight cells per byte
+    const unsigned long long kPrime = 1099511628211ULL;
+    unsigned long long hash = 14695981039346656037ULL;
+    auto mix = [&hash, kPrime](unsigned int byte) {
+        hash = (hash ^ byte) * kPrime;
+    };
+    for (int shift = 0; shift < 32; shift += 8) {
+        mix((static_cast<unsigned int>(numRows) >> shift) & 0xff);
+    }
+    for (int shift = 0; shift < 32; shift += 8) {
+        mix((static_cast<unsigned int>(numCols) >> shift) & 0xff);
+    }
+    for (int i = 0; i < numRows; i++) {
+        unsigned int byte = 0;
+        int bits = 0;
+        for (int j = 0; j < numCols; j++) {
+            byte |= (grid[i][j] != 0 ? 1u : 0u) << bits;
+            if (++bits == 8) {
+                mix(byte);
+                byte = 0;
+                bits = 0;
+            }
+        }
+        if (bits != 0) mix(byte); // rows start on a fresh byte
+    }
+    return hash;
+}
@@ -15,6 +15,9 @@ public:
     void setGridFields(int numRows, int numCols, int** grid);
     void setGridFieldsEmpty(int numRows, int numCols);
     void operator=(const SimulationGrid& rhs);
+    void swap(SimulationGrid& other); // exchanges contents without copying cells
+    long long getPopulation() const;
+    unsigned long long getHash() const; // of the dimensions and which cells are alive, not their ages
 private:
     int numRows;
     int numCols;
@@ -0,0 +1,311 @@
+/**
+ * File: simulationworker.cpp
+ * --------------------------
+ * Implementation of the background simulation thread and its command queue.
+ */
+
+#include <chrono>  // for steady_clock
+#include <cmath>   // for isinf
+#include <stdexcept> // for runtime_error
+
+#include "life-constants.h" // for kFrameDelay
+#include "simulationworker.h"
+#include "tracing.h"
+#include "logger.h"
+#include "memorytracker.h"
+
+namespace {
+// longest stretch spent computing generations before commands are looked at
+// and a frame is published again; matches the display's refresh rate
+const std::chrono::microseconds kMaxBatchTime(static_cast<long long>(kFrameDelay * 1000));
+// how far the schedule may fall behind before the missed generations are dropped
+const std::chrono::milliseconds kMaxLag(250);
+// how often the achieved rate is recomputed
+const std::chrono::milliseconds kRateWindow(500);
+}
+
+SimulationWorker::Frame::Frame() :
+    undoDepth(0), generation(0), playing(false), population(0),
+    targetGenerationsPerSecond(0), achievedGenerationsPerSecond(0), recording(false) {
+}
+
+SimulationWorker::SimulationWorker() :
+    stopping(false), engine(LifeEngine::create("simple")), generation(0), playing(false), targetRate(0), interval(0),
+    rateWindowGenerations(0), achievedRate(0), recorder(nullptr), replay(nullptr), replayFrame(0) {
+}
+
+SimulationWorker::~SimulationWorker() {
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        thread.join();
+    }
+    while (undoStack.getStackSize() > 0) {
+        delete undoStack.popGrid();
+    }
+    delete recorder;
+    delete replay;
+    delete engine;
+}
+
+void SimulationWorker::start(const SimulationGrid& initialGrid, long long firstGeneration, const LifeRule& rule) {
+    if (thread.joinable()) return;
+    grid = initialGrid;
+    generation = firstGeneration;
+    this->rule = rule;
+    publish();
+    thread = std::thread(&SimulationWorker::run, this);
+}
+
+void SimulationWorker::startReplay(RecordingReader* recording) {
+    if (thread.joinable()) {
+        delete recording;
+        return;
+    }
+    replay = recording;
+    replayFrame = 0;
+    replay->readFrame(0, grid);
+    generation = replay->getGeneration(0);
+    publish();
+    thread = std::thread(&SimulationWorker::run, this);
+}
+
+void SimulationWorker::step() {
+    enqueue(STEP);
+}
+
+void SimulationWorker::undo() {
+    enqueue(UNDO);
+}
+
+void SimulationWorker::play() {
+    enqueue(PLAY);
+}
+
+void SimulationWorker::pause() {
+    enqueue(PAUSE);
+}
+
+void SimulationWorker::setGenerationsPerSecond(double rate) {
+    enqueue(SET_RATE, rate);
+}
+
+void SimulationWorker::startRecording(const std::string& filename) {
+    enqueue(RECORD, 0, filename);
+}
+
+void SimulationWorker::stopRecording() {
+    enqueue(STOP_RECORDING);
+}
+
+bool SimulationWorker::pollFrame() {
+    return frames.update();
+}
+
+const SimulationWorker::Frame& SimulationWorker::getFrame() const {
+    return frames.getReadBuffer();
+}
+
+PipelineStats& SimulationWorker::getStats() {
+    return stats;
+}
+
+void SimulationWorker::enqueue(CommandType type, double rate, const std::string& filename) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        commands.push_back({type, rate, filename});
+    }
+    wakeup.notify_all();
+}
+
+void SimulationWorker::run() {
+    Tracer::setThreadName("simulation");
+    std::chrono::steady_clock::time_point nextGeneration = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        auto ready = [this] { return stopping || !commands.empty(); };
+        if (playing) {
+            wakeup.wait_until(lock, nextGeneration, ready);
+        }
+        else {
+            wakeup.wait(lock, ready);
+        }
+        if (stopping) return;
+
+        if (!commands.empty()) {
+            Command command = commands.front();
+            commands.pop_front();
+            lock.unlock(); // let the GUI keep queueing while we work
+            bool wasPlaying = playing;
+            execute(command);
+            if (playing && !wasPlaying) {
+                nextGeneration = std::chrono::steady_clock::now(); // first generation right away
+                rateWindowStart = nextGeneration;
+                rateWindowGenerations = 0;
+            }
+            else if (!playing) {
+                achievedRate = 0;
+            }
+            publish();
+            lock.lock();
+        }
+        else if (playing && std::chrono::steady_clock::now() >= nextGeneration) {
+            lock.unlock();
+            playDueGenerations(nextGeneration);
+            publish();
+            lock.lock();
+        }
+    }
+}
+
+void SimulationWorker::playDueGenerations(std::chrono::steady_clock::time_point& nextGeneration) {
+    // Compute every generation that has fallen due, back to back, but come up
+    // for air at least once per frame so that commands are not kept waiting
+    // and the display has something new to show.
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point batchEnd = now + kMaxBatchTime;
+    do {
+        execute({STEP, 0, ""});
+        rateWindowGenerations++;
+        nextGeneration += interval;
+        now = std::chrono::steady_clock::now();
+    } while (playing && nextGeneration <= now && now < batchEnd && !hasPendingCommands());
+
+    if (nextGeneration + kMaxLag < now) {
+        LOG_DEBUG("simulation fell behind at generation " << generation << "; skipping ahead");
+        nextGeneration = now; // too far behind to catch up; drop the missed generations
+    }
+    measureRate(now);
+}
+
+bool SimulationWorker::hasPendingCommands() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stopping || !commands.empty();
+}
+
+void SimulationWorker::measureRate(std::chrono::steady_clock::time_point now) {
+    std::chrono::steady_clock::duration elapsed = now - rateWindowStart;
+    if (elapsed < kRateWindow) return;
+    achievedRate = rateWindowGenerations / std::chrono::duration<double>(elapsed).count();
+    rateWindowStart = now;
+    rateWindowGenerations = 0;
+}
+
+void SimulationWorker::execute(const Command& command) {
+    switch (command.type) {
+        case STEP: {
+            if (replay) {
+                stepReplay(1);
+                break;
+            }
+            uint64_t start = PipelineStats::now();
+            {
+                TRACE_SPAN("history push");
+                MEMORY_SCOPE(MemoryTracker::HISTORY);
+                undoStack.pushGrid(new SimulationGrid(grid));
+            }
+            stats.record(PipelineStats::HISTORY_PUSH, start);
+            start = PipelineStats::now();
+            {
+                TRACE_SPAN("advanceBoard");
+                MEMORY_SCOPE(MemoryTracker::ENGINE);
+                engine->step(grid, nextGrid, rule);
+                grid.swap(nextGrid);
+            }
+            stats.record(PipelineStats::COMPUTE, start);
+            generation++;
+            if (recorder) recorder->record(grid, generation);
+            break;
+        }
+        case UNDO:
+            if (replay) {
+                stepReplay(-1);
+            }
+            else if (undoStack.getStackSize() > 0) {
+                TRACE_SPAN("history pop");
+                MEMORY_SCOPE(MemoryTracker::HISTORY);
+                SimulationGrid* previousGrid = undoStack.popGrid();
+                grid = *previousGrid;
+                delete previousGrid;
+                generation--;
+                if (recorder) recorder->record(grid, generation);
+            }
+            break;
+        case PLAY:
+            playing = true;
+            break;
+        case PAUSE:
+            playing = false;
+            break;
+        case SET_RATE:
+            targetRate = command.rate;
+            if (std::isinf(targetRate) || targetRate <= 0) {
+                interval = std::chrono::steady_clock::duration::zero();
+            }
+            else {
+                interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                            std::chrono::duration<double>(1 / targetRate));
+            }
+            break;
+        case RECORD:
+            delete recorder;
+            recorder = nullptr;
+            if (replay) {
+                // the recording being played back may be the very file asked for
+                LOG_WARNING("cannot record while playing back a recording");
+                break;
+            }
+            try {
+                recorder = new Recorder(command.filename, grid.getNumRows(), grid.getNumCols());
+                recorder->record(grid, generation);
+                LOG_INFO("recording to " << command.filename);
+            }
+            catch (const std::runtime_error& ex) {
+                LOG_ERROR(ex.what());
+            }
+            break;
+        case STOP_RECORDING:
+            delete recorder; // waits for the rest of the recording to be written
+            recorder = nullptr;
+            break;
+    }
+}
+
+void SimulationWorker::stepReplay(int frames) {
+    int frame = replayFrame + frames;
+    if (frame < 0 || frame >= replay->getFrameCount()) {
+        playing = false; // ran off the end of the recording
+        return;
+    }
+    uint64_t start = PipelineStats::now();
+    try {
+        replay->readFrame(frame, grid);
+    }
+    catch (const std::runtime_error& ex) {
+        LOG_ERROR(ex.what());
+        playing = false;
+        return;
+    }
+    stats.record(PipelineStats::COMPUTE, start); // decoding stands in for computing
+    replayFrame = frame;
+    generation = replay->getGeneration(frame);
+    if (recorder) recorder->record(grid, generation);
+}
+
+void SimulationWorker::publish() {
+    TRACE_SPAN("publish frame");
+    MEMORY_SCOPE(MemoryTracker::RENDERER);
+    Frame& frame = frames.getWriteBuffer();
+    frame.grid = grid;
+    frame.undoDepth = replay ? replayFrame : undoStack.getStackSize();
+    frame.generation = generation;
+    frame.playing = playing;
+    frame.population = grid.getPopulation();
+    frame.targetGenerationsPerSecond = targetRate;
+    frame.achievedGenerationsPerSecond = achievedRate;
+    frame.recording = recorder != nullptr;
+    frames.publish();
+}
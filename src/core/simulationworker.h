@@ -0,0 +1,166 @@
+/**
+ * File: simulationworker.h
+ * ------------------------
+ * Defines the thread that computes generations in the background so that the
+ * GUI thread only ever has to queue commands and draw results.
+ */
+
+#ifndef SIMULATIONWORKER_H
+#define SIMULATIONWORKER_H
+#include <thread>             // for std::thread
+#include <mutex>              // for std::mutex
+#include <condition_variable> // for std::condition_variable
+#include <deque>              // for std::deque
+#include <chrono>             // for steady_clock
+#include <string>             // for std::string
+
+#include "simulationgrid.h"
+#include "gridstack.h"
+#include "triplebuffer.h"
+#include "lifeengine.h"
+#include "liferule.h"
+#include "pipelinestats.h"
+#include "recording.h"
+
+/**
+ * Runs the Game of Life on a dedicated thread. Callers (the GUI listeners)
+ * never touch the grid directly: they queue commands, which return at once,
+ * and pick up the results with pollFrame. Every command that changes what
+ * should be on screen publishes a new frame; frames published faster than
+ * they are polled are dropped, so the caller only ever sees the newest one.
+ */
+class SimulationWorker {
+public:
+    /**
+     * Everything the GUI needs to show one state of the simulation.
+     */
+    struct Frame {
+        SimulationGrid grid;
+        int undoDepth;       // how many generations can currently be undone
+        long long generation;
+        bool playing;
+        long long population;
+        double targetGenerationsPerSecond;   // as requested with setGenerationsPerSecond
+        double achievedGenerationsPerSecond; // measured over the last half second of playing
+        bool recording;
+        Frame();
+    };
+
+    SimulationWorker();
+    ~SimulationWorker();
+
+    /**
+     * Starts the worker thread on a copy of the given grid and publishes it
+     * as generation firstGeneration (0 unless resuming a saved run). Every
+     * generation is computed under the given rule. Has no effect if the
+     * worker is already running.
+     */
+    void start(const SimulationGrid& initialGrid, long long firstGeneration = 0, const LifeRule& rule = LifeRule());
+
+    /**
+     * Starts the worker thread on a recording instead, taking ownership of it.
+     * Nothing is computed: stepping moves to the next recorded frame, undo to
+     * the previous one (undoDepth is the frame number), and playing shows the
+     * frames at the target rate until the last one. Has no effect if the
+     * worker is already running.
+     */
+    void startReplay(RecordingReader* recording);
+
+    /**
+     * Queues a request to compute one generation, remembering the current
+     * one so that it can be undone.
+     */
+    void step();
+
+    /**
+     * Queues a request to go back to the previous generation, if any.
+     */
+    void undo();
+
+    /**
+     * Queues requests to start or stop computing generations at the target rate.
+     */
+    void play();
+    void pause();
+
+    /**
+     * Queues a change of the number of generations to compute per second
+     * while playing. Infinity means as fast as possible. When the target is
+     * higher than the display's frame rate, all generations that fall due
+     * within a frame are computed back to back and only the last is published.
+     */
+    void setGenerationsPerSecond(double rate);
+
+    /**
+     * Queues a request to record every generation from the current one on to
+     * the named file (see recording.h), replacing any recording in progress,
+     * or to stop recording. The worker only hands boards to the recorder,
+     * whose own thread writes them; stopping waits for the rest to be written.
+     * Recording is refused while playing back a recording.
+     */
+    void startRecording(const std::string& filename);
+    void stopRecording();
+
+    /**
+     * Moves the newest published frame into getFrame, if one has been
+     * published since the last call; returns whether there was one.
+     * Must only be called from a single (consumer) thread.
+     */
+    bool pollFrame();
+
+    /**
+     * Returns the frame picked up by the last successful pollFrame.
+     */
+    const Frame& getFrame() const;
+
+    /**
+     * Returns the timings of the stages of the generation pipeline. The
+     * worker records compute and history; the display records the rest.
+     */
+    PipelineStats& getStats();
+
+private:
+    enum CommandType { STEP, UNDO, PLAY, PAUSE, SET_RATE, RECORD, STOP_RECORDING };
+    struct Command {
+        CommandType type;
+        double rate;
+        std::string filename; // for RECORD
+    };
+
+    void enqueue(CommandType type, double rate = 0, const std::string& filename = "");
+    void run();
+    void playDueGenerations(std::chrono::steady_clock::time_point& nextGeneration);
+    bool hasPendingCommands();
+    void execute(const Command& command);
+    void stepReplay(int frames);
+    void measureRate(std::chrono::steady_clock::time_point now);
+    void publish();
+
+    std::thread thread;
+    std::mutex mutex;                 // guards commands and stopping
+    std::condition_variable wakeup;
+    std::deque<Command> commands;
+    bool stopping;
+
+    // owned by the worker thread once it has started
+    SimulationGrid grid;
+    SimulationGrid nextGrid; // scratch grid the engine writes into
+    LifeEngine* engine;
+    LifeRule rule;
+    GridStack<SimulationGrid*> undoStack;
+    long long generation;
+    bool playing;
+    double targetRate;
+    std::chrono::steady_clock::duration interval; // between generations; zero when unlimited
+    std::chrono::steady_clock::time_point rateWindowStart;
+    long long rateWindowGenerations;
+    double achievedRate;
+    Recorder* recorder;        // null unless recording
+    RecordingReader* replay;   // null unless playing back a recording
+    int replayFrame;
+
+    TripleBuffer<Frame> frames;
+    PipelineStats stats;
+};
+
+#endif // SIMULATIONWORKER_H
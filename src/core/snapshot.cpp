@@ -0,0 +1,196 @@
+/**
+ * File: snapshot.cpp
+ * ------------------
+ * Implementation of binary snapshot writing and reading.
+ */
+
+#include <algorithm> // for min
+#include <cstdio>    // for rename, remove
+#include <cstring>   // for memcmp, memcpy
+#include <fstream>   // for ofstream
+#include <stdexcept> // for runtime_error, invalid_argument
+#include <vector>    // for std::vector
+
+#include "snapshot.h"
+#include "mappedfile.h"
+
+namespace {
+
+const char kMagic[8] = { 'L', 'I', 'F', 'E', 'S', 'N', 'A', 'P' };
+const size_t kHeaderSize = 64;
+const size_t kChecksumOffset = 56;
+const unsigned int kHasAges = 1;
+
+void put32(unsigned char* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+void put64(unsigned char* out, uint64_t value) {
+    for (int i = 0; i < 8; i++) out[i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+uint32_t get32(const unsigned char* in) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; i--) value = (value << 8) | in[i];
+    return value;
+}
+
+uint64_t get64(const unsigned char* in) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) value = (value << 8) | in[i];
+    return value;
+}
+
+// 64-bit FNV-1a of the header up to the checksum and of the planes.
+uint64_t checksum(const unsigned char* header, const unsigned char* planes, size_t planesSize) {
+    const uint64_t kPrime = 1099511628211ULL;
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < kChecksumOffset; i++) {
+        hash = (hash ^ header[i]) * kPrime;
+    }
+    for (size_t i = 0; i < planesSize; i++) {
+        hash = (hash ^ planes[i]) * kPrime;
+    }
+    return hash;
+}
+
+size_t liveBytesPerRow(int numCols) {
+    return (static_cast<size_t>(numCols) + 7) / 8;
+}
+
+size_t ageBytesPerRow(int numCols) {
+    return (static_cast<size_t>(numCols) + 1) / 2;
+}
+}
+
+SnapshotInfo::SnapshotInfo() :
+    generation(0), seed(0) {
+}
+
+void writeSnapshot(const std::string& filename, const SimulationGrid& grid, const SnapshotInfo& info,
+                   bool withAges) {
+    int numRows = grid.getNumRows();
+    int numCols = grid.getNumCols();
+    size_t liveRow = liveBytesPerRow(numCols);
+    size_t ageRow = withAges ? ageBytesPerRow(numCols) : 0;
+    size_t planesSize = static_cast<size_t>(numRows) * (liveRow + ageRow);
+    std::vector<unsigned char> bytes(kHeaderSize + planesSize, 0);
+
+    unsigned char* header = bytes.data();
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    put32(header + 8, kSnapshotVersion);
+    put32(header + 12, withAges ? kHasAges : 0);
+    put32(header + 16, static_cast<uint32_t>(numRows));
+    put32(header + 20, static_cast<uint32_t>(numCols));
+    put32(header + 24, info.rule.getBirthMask());
+    put32(header + 28, info.rule.getSurvivalMask());
+    put64(header + 32, static_cast<uint64_t>(info.generation));
+    put64(header + 40, info.seed);
+    put64(header + 48, planesSize);
+
+    unsigned char* live = header + kHeaderSize;
+    unsigned char* ages = live + static_cast<size_t>(numRows) * liveRow;
+    for (int i = 0; i < numRows; i++) {
+        const int* row = grid.getGrid()[i];
+        unsigned char* liveOut = live + i * liveRow;
+        for (int j = 0; j < numCols; j++) {
+            if (row[j] != 0) liveOut[j >> 3] |= static_cast<unsigned char>(1u << (j & 7));
+        }
+        if (withAges) {
+            unsigned char* ageOut = ages + i * ageRow;
+            for (int j = 0; j < numCols; j++) {
+                unsigned int age = static_cast<unsigned int>(std::min(std::max(row[j], 0), 15));
+                ageOut[j >> 1] |= static_cast<unsigned char>(age << ((j & 1) * 4));
+            }
+        }
+    }
+    put64(header + kChecksumOffset, checksum(header, live, planesSize));
+
+    // written beside the old snapshot and renamed over it, so a failed save never loses it
+    std::string temporary = filename + ".tmp";
+    {
+        std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+        if (!output) {
+            throw std::runtime_error("writeSnapshot: cannot write \"" + temporary + "\"");
+        }
+        output.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!output) {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("writeSnapshot: error writing \"" + temporary + "\"");
+        }
+    }
+#ifdef _WIN32
+    std::remove(filename.c_str()); // rename does not replace files on Windows
+#endif
+    if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("writeSnapshot: cannot replace \"" + filename + "\"");
+    }
+}
+
+void readSnapshot(const std::string& filename, SimulationGrid& grid, SnapshotInfo* info) {
+    MappedFile file(filename);
+    file.adviseSequential();
+    readSnapshot(file.getData(), file.getSize(), grid, info);
+}
+
+void readSnapshot(const char* data, size_t size, SimulationGrid& grid, SnapshotInfo* info) {
+    if (!isSnapshot(data, size) || size < kHeaderSize) {
+        throw std::runtime_error("readSnapshot: not a snapshot");
+    }
+    const unsigned char* header = reinterpret_cast<const unsigned char*>(data);
+    uint32_t version = get32(header + 8);
+    if (version > kSnapshotVersion) {
+        throw std::runtime_error("readSnapshot: snapshot version " + std::to_string(version)
+                                 + " is newer than this program");
+    }
+    bool withAges = (get32(header + 12) & kHasAges) != 0;
+    int numRows = static_cast<int>(get32(header + 16));
+    int numCols = static_cast<int>(get32(header + 20));
+    uint64_t planesSize = get64(header + 48);
+    if (numRows <= 0 || numCols <= 0) {
+        throw std::runtime_error("readSnapshot: bad dimensions");
+    }
+    size_t liveRow = liveBytesPerRow(numCols);
+    size_t ageRow = withAges ? ageBytesPerRow(numCols) : 0;
+    if (planesSize != static_cast<uint64_t>(numRows) * (liveRow + ageRow) || planesSize > size - kHeaderSize) {
+        throw std::runtime_error("readSnapshot: snapshot is truncated");
+    }
+    const unsigned char* live = header + kHeaderSize;
+    if (checksum(header, live, static_cast<size_t>(planesSize)) != get64(header + kChecksumOffset)) {
+        throw std::runtime_error("readSnapshot: checksum mismatch; the snapshot is damaged");
+    }
+    if (info != nullptr) {
+        try {
+            info->rule = LifeRule::fromMasks(get32(header + 24), get32(header + 28));
+        }
+        catch (const std::invalid_argument& ex) {
+            throw std::runtime_error(std::string("readSnapshot: ") + ex.what());
+        }
+        info->generation = static_cast<long long>(get64(header + 32));
+        info->seed = get64(header + 40);
+    }
+
+    grid.setGridFieldsEmpty(numRows, numCols);
+    const unsigned char* ages = live + static_cast<size_t>(numRows) * liveRow;
+    for (int i = 0; i < numRows; i++) {
+        int* row = grid.getGrid()[i];
+        const unsigned char* liveIn = live + i * liveRow;
+        const unsigned char* ageIn = ages + i * ageRow;
+        for (int j = 0; j < numCols; j++) {
+            if (!((liveIn[j >> 3] >> (j & 7)) & 1)) continue;
+            int age = withAges ? (ageIn[j >> 1] >> ((j & 1) * 4)) & 0xf : 1;
+            row[j] = age == 0 ? 1 : age;
+        }
+    }
+}
+
+bool isSnapshot(const char* data, size_t size) {
+    return size >= sizeof(kMagic) && std::memcmp(data, kMagic, sizeof(kMagic)) == 0;
+}
+
+bool isSnapshotFile(const std::string& filename) {
+    std::ifstream input(filename, std::ios::binary);
+    char start[sizeof(kMagic)];
+    return input.read(start, sizeof(start)) && isSnapshot(start, sizeof(start));
+}
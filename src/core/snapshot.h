@@ -0,0 +1,76 @@
+/**
+ * File: snapshot.h
+ * ----------------
+ * Defines a compact binary snapshot of a running simulation, so that a long
+ * run can be saved and resumed exactly instead of simulated again.
+ *
+ * A snapshot is a 64-byte header followed by the cell planes, all integers
+ * little-endian:
+ *
+ *    offset  size  contents
+ *         0     8  "LIFESNAP"
+ *         8     4  format version (kSnapshotVersion)
+ *        12     4  flags: 1 if an age plane follows the liveness plane
+ *        16     4  rows
+ *        20     4  columns
+ *        24     4  birth mask of the rule (bit n: born with n neighbours)
+ *        28     4  survival mask of the rule
+ *        32     8  generation number
+ *        40     8  random seed the run started from (0 if none)
+ *        48     8  size of the planes in bytes
+ *        56     8  64-bit FNV-1a checksum of bytes 0-55 and the planes
+ *
+ * The liveness plane has one bit per cell, eight cells to a byte starting at
+ * the low bit, each row starting on a fresh byte. The optional age plane has
+ * four bits per cell, two to a byte starting with the low nibble, each row
+ * again starting on a fresh byte. Without it, live cells load with age 1.
+ *
+ * A snapshot is written with one write call and read through one mapping.
+ */
+
+#pragma once
+#include <cstddef> // for size_t
+#include <cstdint> // for uint64_t
+#include <string>  // for std::string
+
+#include "simulationgrid.h"
+#include "liferule.h"
+
+const unsigned int kSnapshotVersion = 1;
+
+/**
+ * Everything in a snapshot besides the cells.
+ */
+struct SnapshotInfo {
+    LifeRule rule;
+    long long generation;
+    uint64_t seed;
+
+    SnapshotInfo();
+};
+
+/**
+ * Writes grid and info to the named file, replacing it only once the new
+ * snapshot is completely written. Ages above 15 are saved as 15. Throws
+ * std::runtime_error if the file cannot be written.
+ */
+void writeSnapshot(const std::string& filename, const SimulationGrid& grid, const SnapshotInfo& info,
+                   bool withAges = true);
+
+/**
+ * Reads the named snapshot into grid, and into info if it is not null.
+ * Throws std::runtime_error if the file cannot be read, is not a snapshot,
+ * has a newer version, or fails its checksum.
+ */
+void readSnapshot(const std::string& filename, SimulationGrid& grid, SnapshotInfo* info = nullptr);
+
+/**
+ * Reads a snapshot already in memory, as readSnapshot does.
+ */
+void readSnapshot(const char* data, size_t size, SimulationGrid& grid, SnapshotInfo* info = nullptr);
+
+/**
+ * Returns whether the given bytes, or the named file, start like a snapshot.
+ */
+bool isSnapshot(const char* data, size_t size);
+bool isSnapshotFile(const std::string& filename);
@@ -0,0 +1,164 @@
+/**
+ * File: soup.cpp
+ * --------------
+ * Implementation of reproducible random soups.
+ */
+
+#include <algorithm> // for min, max
+#include <cmath>     // for lround
+#include <cstring>   // for memcpy
+#include <random>    // for random_device
+#include <stdexcept> // for invalid_argument
+#include <thread>    // for std::thread
+#include <vector>    // for std::vector
+
+#include "soup.h"
+#include "life-constants.h" // for kMaxAge
+#include "tracing.h"
+
+namespace {
+
+// boards with fewer cells than this are filled on the calling thread alone
+const long long kMinParallelCells = 1 << 18;
+
+// SplitMix64, which turns any sequence of seeds into well-mixed ones.
+uint64_t splitMix(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+uint64_t rotateLeft(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+/*
+ * xoshiro256** by Blackman and Vigna: 256 bits of state, 64 random bits per
+ * call for a handful of shifts and multiplies.
+ */
+class Xoshiro256 {
+public:
+    Xoshiro256(uint64_t seed, uint64_t stream) {
+        uint64_t mixer = seed ^ splitMix(stream);
+        for (uint64_t& word : state) word = splitMix(mixer);
+    }
+
+    uint64_t next() {
+        uint64_t result = rotateLeft(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotateLeft(state[3], 45);
+        return result;
+    }
+
+private:
+    uint64_t state[4];
+};
+
+/*
+ * Returns 64 bits each set with probability numerator / 256. Reading the
+ * numerator's bits from the lowest set one up, a 1 ors in a fresh draw and
+ * a 0 ands one in, which halves or half-fills the probability so far.
+ */
+uint64_t drawMask(Xoshiro256& generator, int numerator, int lowestBit) {
+    if (numerator == 0) return 0;
+    if (numerator == 256) return ~0ULL;
+    uint64_t mask = generator.next();
+    for (int bit = lowestBit + 1; bit < 8; bit++) {
+        uint64_t draw = generator.next();
+        mask = ((numerator >> bit) & 1) ? (mask | draw) : (mask & draw);
+    }
+    return mask;
+}
+
+/*
+ * The eight cells, 0 or 1, that each byte of a mask stands for.
+ */
+struct ByteCells {
+    int cells[256][8];
+
+    ByteCells() {
+        for (int byte = 0; byte < 256; byte++) {
+            for (int bit = 0; bit < 8; bit++) cells[byte][bit] = (byte >> bit) & 1;
+        }
+    }
+};
+const ByteCells kByteCells;
+
+void fillRows(int** rows, int firstRow, int endRow, int numCols, uint64_t seed, int numerator,
+              bool randomAges) {
+    int lowestBit = 0;
+    while (lowestBit < 8 && ((numerator >> lowestBit) & 1) == 0) lowestBit++;
+    for (int i = firstRow; i < endRow; i++) {
+        int* row = new int[numCols];
+        rows[i] = row;
+        Xoshiro256 generator(seed, static_cast<uint64_t>(i));
+        for (int j = 0; j < numCols; j += 64) {
+            uint64_t mask = drawMask(generator, numerator, lowestBit);
+            int count = std::min(64, numCols - j);
+            if (!randomAges) {
+                int b = 0;
+                for (; b + 8 <= count; b += 8) { // a byte of the mask at a time
+                    std::memcpy(row + j + b, kByteCells.cells[(mask >> b) & 0xff], sizeof(kByteCells.cells[0]));
+                }
+                for (; b < count; b++) {
+                    row[j + b] = static_cast<int>((mask >> b) & 1);
+                }
+                continue;
+            }
+            for (int b = 0; b < count; b += 8) {
+                uint64_t bytes = generator.next(); // one random byte per cell
+                for (int k = 0; k < 8 && b + k < count; k++) {
+                    int age = 1 + static_cast<int>(((bytes >> (8 * k)) & 0xff) * kMaxAge >> 8);
+                    row[j + b + k] = age & -static_cast<int>((mask >> (b + k)) & 1);
+                }
+            }
+        }
+    }
+}
+}
+
+void fillRandomSoup(SimulationGrid& grid, int numRows, int numCols, uint64_t seed, double density,
+                    bool randomAges, int numThreads) {
+    if (numRows <= 0 || numCols <= 0) {
+        throw std::invalid_argument("fillRandomSoup: dimensions must be positive");
+    }
+    if (!(density >= 0 && density <= 1)) {
+        throw std::invalid_argument("fillRandomSoup: density must be between 0 and 1");
+    }
+    TRACE_SPAN("fill soup");
+    int numerator = static_cast<int>(std::lround(density * 256));
+    if (numThreads <= 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+    if (static_cast<long long>(numRows) * numCols < kMinParallelCells) numThreads = 1;
+    numThreads = std::min(numThreads, numRows);
+
+    // Rows are allocated by the thread that fills them, so each band's
+    // memory is first touched, and ends up, near the core that will fill it.
+    int** rows = new int*[numRows];
+    std::vector<std::thread> helpers;
+    for (int band = 1; band < numThreads; band++) {
+        helpers.emplace_back(fillRows, rows, static_cast<int>(static_cast<long long>(numRows) * band / numThreads),
+                             static_cast<int>(static_cast<long long>(numRows) * (band + 1) / numThreads),
+                             numCols, seed, numerator, randomAges);
+    }
+    fillRows(rows, 0, numRows / numThreads, numCols, seed, numerator, randomAges);
+    for (std::thread& helper : helpers) helper.join();
+    grid.setGridFields(numRows, numCols, rows);
+}
+
+uint64_t makeRandomSeed() {
+    std::random_device device;
+    return (static_cast<uint64_t>(device()) << 32) ^ device();
+}
+
+int seededRandomInt(uint64_t seed, uint64_t index, int low, int high) {
+    // a stream of its own, well away from the rows of any board
+    Xoshiro256 generator(seed, ~index);
+    uint64_t range = static_cast<uint64_t>(high - low) + 1;
+    return low + static_cast<int>(generator.next() % range);
+}
@@ -0,0 +1,42 @@
+/**
+ * File: soup.h
+ * ------------
+ * Defines the generator of random starting boards ("soups"). Boards are
+ * reproducible: the same seed, size and density always give the same board,
+ * on any machine and with any number of threads.
+ *
+ * Each row has its own xoshiro256** generator, seeded from the board's seed
+ * and the row number, so rows can be filled in any order and on any thread.
+ * Every draw decides 64 cells: a cell is alive with probability density,
+ * rounded to a multiple of 1/256, by combining up to eight draws bit by bit
+ * (one for density 0.5, two for 0.25 or 0.75, and so on).
+ */
+
+#pragma once
+#include <cstdint> // for uint64_t
+
+#include "simulationgrid.h"
+
+/**
+ * Replaces grid's contents with a numRows by numCols soup in which each cell
+ * is alive with probability density. Live cells have age 1, or if randomAges
+ * is set an age from 1 to kMaxAge picked at random. Rows are filled in bands
+ * on numThreads threads (0 means one per hardware thread; small boards use
+ * one). Throws std::invalid_argument if a dimension is not positive or the
+ * density is outside [0, 1].
+ */
+void fillRandomSoup(SimulationGrid& grid, int numRows, int numCols, uint64_t seed, double density = 0.5,
+                    bool randomAges = false, int numThreads = 0);
+
+/**
+ * Returns a seed from the system's source of randomness, for runs that were
+ * not given one.
+ */
+uint64_t makeRandomSeed();
+
+/**
+ * Returns a random integer from low to high inclusive, determined by seed and
+ * index alone, for the other choices a seeded run makes (such as the size of
+ * the board).
+ */
+int seededRandomInt(uint64_t seed, uint64_t index, int low, int high);
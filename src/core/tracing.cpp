@@ -0,0 +1,201 @@
+/**
+ * File: tracing.cpp
+ * -----------------
+ * Implementation of the per-thread span rings and the trace writer.
+ */
+
+#include <algorithm> // for remove_if
+#include <chrono>    // for steady_clock
+#include <cstdio>    // for snprintf
+#include <fstream>   // for ofstream
+#include <memory>    // for std::unique_ptr
+#include <mutex>     // for std::mutex
+#include <vector>    // for std::vector
+
+#include "tracing.h"
+
+namespace {
+
+const int kRingSize = 1 << 16; // spans kept per thread; a power of two
+
+/*
+ * One thread's spans. Only the owning thread writes; the fields are atomics
+ * only so that writeChromeTrace may read them from another thread.
+ */
+struct ThreadRing {
+    struct Span {
+        std::atomic<const char*> name;
+        std::atomic<uint64_t> start;
+        std::atomic<uint64_t> end;
+    };
+
+    int threadId;
+    std::string threadName; // guarded by registryMutex
+    bool exited; // guarded by registryMutex
+    std::atomic<uint64_t> count; // spans ever recorded since the last reset
+    std::atomic<uint64_t> generation; // bumped by setEnabled(true) to discard old spans
+    Span spans[kRingSize];
+};
+
+std::mutex registryMutex; // guards rings, nextThreadId and the rings' names; taken only for a thread's first span
+// the rings of running threads, and of exited threads until their spans are written out or discarded
+std::vector<std::unique_ptr<ThreadRing>> rings;
+int nextThreadId = 1;
+std::atomic<uint64_t> traceGeneration(0);
+
+bool hasCurrentSpans(const ThreadRing& ring) {
+    return ring.count.load() != 0 && ring.generation.load() == traceGeneration.load();
+}
+
+// Frees the rings of exited threads that hold nothing left to write. Call with registryMutex held.
+void freeExitedRings(bool evenWithSpans) {
+    rings.erase(std::remove_if(rings.begin(), rings.end(), [evenWithSpans](const std::unique_ptr<ThreadRing>& ring) {
+        return ring->exited && (evenWithSpans || !hasCurrentSpans(*ring));
+    }), rings.end());
+}
+
+/*
+ * A thread's name and ring. The ring is only allocated when the thread
+ * first records a span, so threads that never do while tracing is on cost
+ * nothing; when the thread exits, its ring is freed, or kept until its
+ * spans have been written out.
+ */
+struct ThreadState {
+    std::string name;
+    ThreadRing* ring;
+
+    ThreadState() : ring(nullptr) {
+    }
+
+    ~ThreadState() {
+        if (ring == nullptr) return;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        ring->exited = true;
+        freeExitedRings(false);
+    }
+};
+
+ThreadState& getThreadState() {
+    thread_local ThreadState state;
+    return state;
+}
+
+}
+
+std::string quoteJson(const std::string& text) {
+    std::string result = "\"";
+    for (char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            result += '\\';
+            result += ch;
+        }
+        else if (static_cast<unsigned char>(ch) < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", ch);
+            result += escape;
+        }
+        else {
+            result += ch;
+        }
+    }
+    return result + "\"";
+}
+
+std::atomic<bool> Tracer::enabled(false);
+
+void Tracer::setEnabled(bool enabled) {
+    if (enabled && !Tracer::enabled) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        traceGeneration++; // each ring resets itself on its next span
+        freeExitedRings(true); // their spans are discarded
+    }
+    Tracer::enabled = enabled;
+}
+
+void Tracer::setThreadName(const std::string& name) {
+    ThreadState& state = getThreadState();
+    state.name = name;
+    if (state.ring != nullptr) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        state.ring->threadName = name;
+    }
+}
+
+uint64_t Tracer::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Tracer::record(const char* name, uint64_t start, uint64_t end) {
+    ThreadState& state = getThreadState();
+    if (state.ring == nullptr) {
+        if (!isEnabled()) return; // turned off while the span ran
+        std::lock_guard<std::mutex> lock(registryMutex);
+        rings.push_back(std::unique_ptr<ThreadRing>(new ThreadRing()));
+        state.ring = rings.back().get();
+        state.ring->threadId = nextThreadId++;
+        state.ring->threadName = state.name;
+        state.ring->exited = false;
+        state.ring->count = 0;
+        state.ring->generation = traceGeneration.load();
+    }
+    ThreadRing& ring = *state.ring;
+    uint64_t generation = traceGeneration.load(std::memory_order_relaxed);
+    uint64_t count = ring.count.load(std::memory_order_relaxed);
+    if (ring.generation.load(std::memory_order_relaxed) != generation) {
+        ring.generation.store(generation, std::memory_order_relaxed);
+        count = 0;
+    }
+    ThreadRing::Span& span = ring.spans[count & (kRingSize - 1)];
+    span.name.store(name, std::memory_order_relaxed);
+    span.start.store(start, std::memory_order_relaxed);
+    span.end.store(end, std::memory_order_relaxed);
+    ring.count.store(count + 1, std::memory_order_release);
+}
+
+bool Tracer::writeChromeTrace(const std::string& filename) {
+    std::ofstream out(filename);
+    if (!out) return false;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    uint64_t generation = traceGeneration.load();
+    uint64_t origin = UINT64_MAX; // make timestamps start near zero
+    for (const std::unique_ptr<ThreadRing>& ring : rings) {
+        uint64_t count = ring->count.load(std::memory_order_acquire);
+        if (ring->generation.load() != generation || count == 0) continue;
+        uint64_t first = count > kRingSize ? count - kRingSize : 0;
+        uint64_t start = ring->spans[first & (kRingSize - 1)].start.load(std::memory_order_relaxed);
+        if (start < origin) origin = start;
+    }
+
+    out << "{\"traceEvents\": [\n";
+    out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, "
+        << "\"args\": {\"name\": \"Game of Life\"}}";
+    char number[64];
+    for (const std::unique_ptr<ThreadRing>& ring : rings) {
+        std::string threadName = ring->threadName.empty()
+                ? "thread " + std::to_string(ring->threadId) : ring->threadName;
+        out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << ring->threadId
+            << ", \"args\": {\"name\": " << quoteJson(threadName) << "}}";
+
+        uint64_t count = ring->count.load(std::memory_order_acquire);
+        if (ring->generation.load() != generation) continue;
+        uint64_t first = count > kRingSize ? count - kRingSize : 0;
+        for (uint64_t i = first; i < count; i++) {
+            const ThreadRing::Span& span = ring->spans[i & (kRingSize - 1)];
+            const char* name = span.name.load(std::memory_order_relaxed);
+            uint64_t start = span.start.load(std::memory_order_relaxed);
+            uint64_t end = span.end.load(std::memory_order_relaxed);
+            if (name == nullptr || start < origin || end < start) continue; // overwritten while we read
+            // "X" events are complete spans; times are in microseconds
+            std::snprintf(number, sizeof(number), "%.3f, \"dur\": %.3f",
+                          (start - origin) / 1000.0, (end - start) / 1000.0);
+            out << ",\n{\"name\": " << quoteJson(name) << ", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+                << ring->threadId << ", \"ts\": " << number << "}";
+        }
+    }
+    out << "\n],\n\"displayTimeUnit\": \"ms\"}\n";
+    if (!out) return false;
+    freeExitedRings(true); // their spans are written out
+    return true;
+}
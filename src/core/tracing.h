@@ -0,0 +1,103 @@
+/**
+ * File: tracing.h
+ * ---------------
+ * Defines an optional trace of what each thread was doing when, written out
+ * in the Chrome trace event format so it can be opened in Perfetto
+ * (ui.perfetto.dev) or chrome://tracing.
+ *
+ * Code marks the work it wants to see with scoped spans:
+ *
+ *    void LifeDisplay::drawBoard() {
+ *        TRACE_SPAN("drawBoard");
+ *        ...
+ *    }
+ *
+ * While tracing is off (the default) a span costs one relaxed atomic load
+ * and a branch. While it is on, each thread appends finished spans to its own
+ * fixed-size ring without taking any locks; once a ring is full its oldest
+ * spans are overwritten. A thread's ring is allocated at its first span
+ * while tracing is on, and freed once the thread has exited and its spans
+ * have been written out or discarded. Defining LIFE_NO_TRACING compiles
+ * spans out.
+ *
+ * Span names must be string literals (or otherwise outlive the trace), since
+ * only the pointer is recorded.
+ */
+
+#pragma once
+#include <atomic>  // for std::atomic
+#include <cstdint> // for uint64_t
+#include <string>  // for std::string
+
+class Tracer {
+public:
+/**
+ * Turns recording on or off. Turning it on discards spans recorded earlier.
+ */
+    static void setEnabled(bool enabled);
+
+    static bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+/**
+ * Names the calling thread in the trace (e.g. "simulation").
+ */
+    static void setThreadName(const std::string& name);
+
+/**
+ * Writes every span still held by any thread's ring to the named file as
+ * Chrome trace event JSON. Returns false if the file cannot be written.
+ * Spans that are still being recorded while this runs may be missed.
+ */
+    static bool writeChromeTrace(const std::string& filename);
+
+/**
+ * Returns a timestamp in nanoseconds for use with record.
+ */
+    static uint64_t now();
+
+/**
+ * Appends a finished span to the calling thread's ring.
+ */
+    static void record(const char* name, uint64_t start, uint64_t end);
+
+private:
+    static std::atomic<bool> enabled;
+};
+
+/**
+ * Records the time from its construction to its destruction as a span, if
+ * tracing was on when it was constructed. Use through TRACE_SPAN.
+ */
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name) :
+        name(Tracer::isEnabled() ? name : nullptr), start(this->name ? Tracer::now() : 0) {
+    }
+
+    ~TraceSpan() {
+        if (name) Tracer::record(name, start, Tracer::now());
+    }
+
+private:
+    const char* name; // nullptr when not recording
+    uint64_t start;
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+/**
+ * Returns text as a JSON string literal, quotes included, escaping quotes,
+ * backslashes and control characters.
+ */
+std::string quoteJson(const std::string& text);
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#ifdef LIFE_NO_TRACING
+#define TRACE_SPAN(name) do { } while (0)
+#else
+#define TRACE_SPAN(name) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name)
+#endif
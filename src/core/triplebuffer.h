@@ -0,0 +1,58 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+#include <atomic>
+
+/**
+ * A single-producer, single-consumer triple buffer. The producer always owns
+ * a slot to write the next value into and publishing never blocks; the
+ * consumer always picks up the most recently published value, so values
+ * published between two reads are dropped rather than queued.
+ */
+template <class Type>
+class TripleBuffer {
+public:
+    TripleBuffer();
+    Type& getWriteBuffer();
+    void publish();
+    bool update();
+    const Type& getReadBuffer() const;
+
+private:
+    static const int kFreshBit = 4; // set on the spare index when it holds an unread value
+    Type buffers[3];
+    int writeIndex; // owned by the producer
+    int readIndex;  // owned by the consumer
+    std::atomic<int> spareIndex;
+};
+
+template <class Type>
+TripleBuffer<Type>::TripleBuffer() :
+    writeIndex(0), readIndex(1), spareIndex(2) {
+}
+
+template <class Type>
+Type& TripleBuffer<Type>::getWriteBuffer() {
+    return buffers[writeIndex];
+}
+
+template <class Type>
+void TripleBuffer<Type>::publish() {
+    // hand the freshly written slot over and take the spare one to write into next
+    writeIndex = spareIndex.exchange(writeIndex | kFreshBit) & ~kFreshBit;
+}
+
+template <class Type>
+bool TripleBuffer<Type>::update() {
+    if ((spareIndex.load() & kFreshBit) == 0) {
+        return false; // nothing published since the last update
+    }
+    readIndex = spareIndex.exchange(readIndex) & ~kFreshBit;
+    return true;
+}
+
+template <class Type>
+const Type& TripleBuffer<Type>::getReadBuffer() const {
+    return buffers[readIndex];
+}
+
+#endif // TRIPLEBUFFER_H
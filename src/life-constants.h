@@ -1,22 +0,0 @@
-/**
- * File: life-constants.h
- * ----------------------
- * Defines those constants which are shared by both the
- * life-graphics module and the main life module.
- */
-
-#pragma once
-
-/**
- * Constants
- * ---------
- * Both the graphics module and the main module need to agree
- * that cells of age kMaxAge and above are equally old--at least
- * for display purposes.
- */
-const int kMaxAge = 12;
-const double timerDelayMode1 = 3000;
-const double timerDelayMode2 = 1500;
-const double timerDelayMode3 = 800;
-const std::pair<int, int> directions[] = { {-1, -1}, {-1, 0}, {-1, 1}, {0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1} };
-
@@ -14,6 +14,8 @@
 #include <sstream>  // for ostringstream
 #include <iomanip>  // for setw, setfill
 #include <ios>      // for hex stream manipulator
+#include <cmath>    // for sqrt
+#include <chrono>   // for steady_clock
 using namespace std;
 #include "random.h" // for randomInteger
 #include "strlib.h" // for integerToString
@@ -22,10 +24,17 @@ using namespace std;
 
 #include "life-constants.h"
 #include "life-graphics.h"
+#include "tracing.h"
+#include "memorytracker.h"
+#include "frameexport.h"
 const string LifeDisplay::kDefaultWindowTitle("Game of Life");
 const double kWindowPadding = 5; // Margin from border of window to content area
+const unsigned int kOpaqueBlack = 0xff000000; // ARGB; or'ed into RGB colors to make them opaque
 
-LifeDisplay::LifeDisplay() {
+LifeDisplay::LifeDisplay() :
+    numRows(0), numColumns(0), zoom(1), firstVisibleRow(0), firstVisibleColumn(0),
+    visibleRows(0), visibleColumns(0), replaying(false), statsVisible(false), lastStatsUpdate(0), lastStatsGeneration(0),
+    lastMemory(MemoryTracker::getSnapshot()) {
     window = new GWindow(kDisplayWidth, kDisplayHeight);
     //gameGrid;
     initializeColors();
@@ -35,6 +44,10 @@ LifeDisplay::LifeDisplay() {
     window->setAutoRepaint(false);
     window->setExitOnClose(true);
     window->setDisplay(this);
+    statsLabel = new GLabel("");
+    statsLabel->setFont("Monospaced-11");
+    statsLabel->setVisible(false);
+    window->addToRegion(statsLabel, GWindow::REGION_SOUTH);
 }
 
 LifeDisplay::~LifeDisplay() {
@@ -44,20 +57,31 @@ LifeDisplay::~LifeDisplay() {
 }
 
 void LifeDisplay::fillCellGrid() {
-    cells.clear();
-    cells.resize(numRows, numColumns);
+    TRACE_SPAN("fillCellGrid");
+    cells.resize(visibleRows, visibleColumns);
     GThread::runOnQtGuiThread([&, this] {
-        for (int r = 0; r < numRows; ++r) {
-            for (int c = 0; c < numColumns; ++c) {
+        MEMORY_SCOPE(MemoryTracker::SCENE_GRAPH); // on the Qt thread, which has its own scope
+        Vector<GObject*> newCells;
+        for (int r = 0; r < visibleRows; ++r) {
+            for (int c = 0; c < visibleColumns; ++c) {
                 cells[r][c] = new GOval(upperLeftX + c * cellDiameter + 1, upperLeftY + r * cellDiameter + 1,
                                         cellDiameter - 2, cellDiameter - 2);
                 cells[r][c]->setVisible(false);
-                window->add(cells[r][c]); // ownership of memory has been transferred over to window.
+                newCells.add(cells[r][c]);
             }
         }
+        window->addAll(newCells); // one batch, one repaint; ownership of memory has been transferred over to window.
     });
 }
 
+void LifeDisplay::clearCellGrid() {
+    // only called once the window no longer holds the ovals, so we own them again
+    for (GOval* oval : cells) {
+        delete oval;
+    }
+    cells.clear();
+}
+
 void LifeDisplay::setDimensions(int numRows, int numColumns) {
     if (numRows <= 0 || numColumns <= 0) {
         error("LifeDisplay::setDimensions number of rows and columns must both be positive!");
@@ -65,20 +89,35 @@ void LifeDisplay::setDimensions(int numRows, int numColumns) {
     
     this->numRows = numRows;
     this->numColumns = numColumns;
+    MEMORY_SCOPE(MemoryTracker::RENDERER);
     ages.resize(numRows, numColumns);
+    agePyramid.resize(numRows, numColumns);
+    zoom = 1;
+    firstVisibleRow = 0;
+    firstVisibleColumn = 0;
+    layoutViewport();
+}
+
+void LifeDisplay::layoutViewport() {
+    TRACE_SPAN("layoutViewport");
+    MEMORY_SCOPE(MemoryTracker::SCENE_GRAPH);
     computeGeometry();
     window->clear();
-    fillCellGrid();
+    clearCellGrid();
+    if (!isPixelMode()) {
+        fillCellGrid();
+        refreshVisibleCells();
+    }
 
     window->setColor("White");
     window->fillRect(0, 0, kDisplayWidth, kDisplayHeight);
     window->setColor("Black");
     window->drawRect(upperLeftX, upperLeftY,
-                    numColumns * cellDiameter + 1, numRows * cellDiameter + 1);
-
+                    visibleColumns * cellDiameter + 1, visibleRows * cellDiameter + 1);
 }
 
 void LifeDisplay::setTitle(const string& title) {
+    if (title == windowTitle) return; // called every frame while the speed is shown
     window->setWindowTitle(title);
     windowTitle = title;
 }
@@ -96,40 +135,157 @@ void LifeDisplay::drawCellAt(int row, int column, int age) {
     }
     
     age = min(age, kMaxAge);
+    int oldAge = ages[row][column];
+    if (age == oldAge) return;
+    agePyramid.update(row, column, oldAge, age);
+    ages[row][column] = age;
+
+    // zoomed-out pixels are redrawn as a whole by renderPixels
+    int visibleRow = row - firstVisibleRow;
+    int visibleColumn = column - firstVisibleColumn;
+    if (!isPixelMode() && visibleRow >= 0 && visibleRow < visibleRows
+            && visibleColumn >= 0 && visibleColumn < visibleColumns) {
+        drawOval(cells[visibleRow][visibleColumn], age);
+    }
+}
+
+void LifeDisplay::drawOval(GOval* oval, int age) {
     if (age == 0) {
-        cells[row][column]->setVisible(false);
+        oval->setVisible(false);
     } else {
-        cells[row][column]->setColor(colors[age]);
-        cells[row][column]->setFillColor(colors[age]);
-        cells[row][column]->setVisible(true);
+        oval->setColor(colors[age]);
+        oval->setFillColor(colors[age]);
+        oval->setVisible(true);
     }
-    ages[row][column] = age;
 }
 
-void LifeDisplay::repaint() {
-    window->repaint();
+void LifeDisplay::refreshVisibleCells() {
+    for (int r = 0; r < visibleRows; r++) {
+        for (int c = 0; c < visibleColumns; c++) {
+            drawOval(cells[r][c], ages[firstVisibleRow + r][firstVisibleColumn + c]);
+        }
+    }
+}
+
+bool LifeDisplay::isPixelMode() const {
+    return cellDiameter < kMinOvalDiameter;
+}
+
+void LifeDisplay::renderPixels() {
+    TRACE_SPAN("renderPixels");
+    MEMORY_SCOPE(MemoryTracker::RENDERER);
+    // pick the pyramid level whose blocks are no larger than one screen pixel
+    double cellsPerPixel = 1.0 / cellDiameter;
+    int level = 0;
+    while (level < agePyramid.getMaxLevel() && (1 << (level + 1)) <= cellsPerPixel) {
+        level++;
+    }
+
+    // only the pixels covered by the visible part of the board are shaded;
+    // the white background around it was drawn by layoutViewport
+    int canvasWidth = static_cast<int>(window->getCanvasWidth());
+    int canvasHeight = static_cast<int>(window->getCanvasHeight());
+    int left = static_cast<int>(upperLeftX);
+    int top = static_cast<int>(upperLeftY);
+    int boardWidth = min(static_cast<int>(visibleColumns * cellDiameter), canvasWidth - left - 2);
+    int boardHeight = min(static_cast<int>(visibleRows * cellDiameter), canvasHeight - top - 2);
+    int stride = boardWidth + 2; // one border pixel on either side
+    pixels.assign(static_cast<size_t>(stride) * (boardHeight + 2), kOpaqueBlack); // border color
+    for (int y = 0; y < boardHeight; y++) {
+        int row = firstVisibleRow + min(visibleRows - 1, static_cast<int>(y * cellsPerPixel));
+        unsigned int* pixelRow = &pixels[static_cast<size_t>(y + 1) * stride + 1];
+        for (int x = 0; x < boardWidth; x++) {
+            int column = firstVisibleColumn + min(visibleColumns - 1, static_cast<int>(x * cellsPerPixel));
+            pixelRow[x] = kOpaqueBlack | static_cast<unsigned int>(shadeAt(level, row, column));
+        }
+    }
+    window->getCanvas()->setPixelsARGB(pixels.data(), left, top, stride, boardHeight + 2);
+}
+
+int LifeDisplay::shadeAt(int level, int row, int column) const {
+    if (level == 0) {
+        return colorValues[ages[row][column]];
+    }
+    int blockRow = row >> level;
+    int blockColumn = column >> level;
+    int liveCount = agePyramid.getLiveCount(level, blockRow, blockColumn);
+    if (liveCount == 0) {
+        return colorValues[0];
+    }
+    int averageAge = static_cast<int>((agePyramid.getAgeSum(level, blockRow, blockColumn) + liveCount / 2) / liveCount);
+    averageAge = max(1, min(averageAge, kMaxAge));
+
+    // blend from white towards the average age's shade; sqrt keeps sparse regions visible
+    double density = sqrt(static_cast<double>(liveCount) / agePyramid.getCellCount(level, blockRow, blockColumn));
+    int shade = colorValues[averageAge];
+    int blended = 0;
+    for (int shift = 0; shift <= 16; shift += 8) {
+        int background = (colorValues[0] >> shift) & 0xff;
+        int foreground = (shade >> shift) & 0xff;
+        blended |= static_cast<int>(background + density * (foreground - background)) << shift;
+    }
+    return blended;
+}
+
+void LifeDisplay::zoomIn() {
+    if (fitCellDiameter * zoom * 2 > kMaxCellDiameter) return;
+    setZoom(zoom * 2);
+}
+
+void LifeDisplay::zoomOut() {
+    if (zoom <= 1) return;
+    setZoom(zoom / 2);
+}
+
+void LifeDisplay::resetView() {
+    setZoom(1);
+}
+
+void LifeDisplay::setZoom(double zoom) {
+    if (numRows == 0) return;
+    // keep the cell at the center of the viewport in the center
+    double centerRow = firstVisibleRow + visibleRows / 2.0;
+    double centerColumn = firstVisibleColumn + visibleColumns / 2.0;
+    this->zoom = zoom;
+    computeGeometry();
+    firstVisibleRow = static_cast<int>(centerRow - visibleRows / 2.0);
+    firstVisibleColumn = static_cast<int>(centerColumn - visibleColumns / 2.0);
+    layoutViewport();
+    if (isPixelMode()) renderPixels();
+    repaint();
+}
+
+void LifeDisplay::pan(int rowSteps, int columnSteps) {
+    if (numRows == 0) return;
+    firstVisibleRow += rowSteps * max(1, visibleRows / 8);
+    firstVisibleColumn += columnSteps * max(1, visibleColumns / 8);
+    computeGeometry(); // clamps the viewport to the grid
+    if (isPixelMode()) {
+        renderPixels();
+    } else {
+        refreshVisibleCells();
+    }
+    repaint();
 }
 
-int LifeDisplay::scalePrimaryColor(int baseContribution, int age) const {
-    const int maxContribution = 220;
-    int remaining = maxContribution - baseContribution;
-    return static_cast<int>(baseContribution + static_cast<double>(age) * remaining / kMaxAge);
+void LifeDisplay::repaint() {
+    window->repaint();
 }
 
 void LifeDisplay::initializeColors() {
+    int baseColor = 0;
+    for (int primary = 0; primary < 3; primary++) {
+        baseColor = (baseColor << 8) | randomInteger(0, 192);
+    }
+    // the same shades as exported frames (see frameexport.h)
+    vector<uint32_t> palette = makeAgePalette(baseColor);
     colors.add("White"); // colors[0] is used for age 0, and is always white
-    int baseColor[] = {
-        randomInteger(0, 192), randomInteger(0, 192), randomInteger(0, 192)
-    };
-    
+    colorValues.add(palette[0]);
     for (int age = 1; age <= kMaxAge; age++) {
         ostringstream oss;
-        oss << "#";
-        for (int primary = 0; primary < 3; primary++) {
-            int contribution = scalePrimaryColor(baseColor[primary], age);
-            oss << setw(2) << setfill('0') << hex << contribution;
-        }
+        oss << "#" << setw(6) << setfill('0') << hex << palette[age];
         colors.add(oss.str());
+        colorValues.add(palette[age]);
     }
 }
 
@@ -138,9 +294,15 @@ void LifeDisplay::computeGeometry() {
     double height = window->getCanvasHeight() - 2 * kWindowPadding;
     double hPixelsPerCell = height / numRows;
     double wPixelsPerCell = width  / numColumns;
-    cellDiameter = min(wPixelsPerCell, hPixelsPerCell);
-    upperLeftX = kWindowPadding + (width  - numColumns * cellDiameter) / 2;
-    upperLeftY = kWindowPadding + (height - numRows    * cellDiameter) / 2;
+    fitCellDiameter = min(wPixelsPerCell, hPixelsPerCell);
+    cellDiameter = fitCellDiameter * zoom;
+    // the small epsilon keeps rounding from dropping the last row at zoom 1
+    visibleRows    = max(1, min(numRows,    static_cast<int>(height / cellDiameter + 1e-9)));
+    visibleColumns = max(1, min(numColumns, static_cast<int>(width  / cellDiameter + 1e-9)));
+    firstVisibleRow    = max(0, min(firstVisibleRow,    numRows    - visibleRows));
+    firstVisibleColumn = max(0, min(firstVisibleColumn, numColumns - visibleColumns));
+    upperLeftX = kWindowPadding + (width  - visibleColumns * cellDiameter) / 2;
+    upperLeftY = kWindowPadding + (height - visibleRows    * cellDiameter) / 2;
 }
 
 bool LifeDisplay::coordinateInRange(int row, int column) const {
@@ -158,79 +320,55 @@ void LifeDisplay::printBoard() {
 }
 
 void LifeDisplay::drawBoard() {
-    setDimensions(gameGrid.getNumRows(), gameGrid.getNumCols());
-    for (int i = 0; i < gameGrid.getNumRows(); i++) {
-        for (int j = 0; j < gameGrid.getNumCols(); j++) {
-            drawCellAt(i, j, gameGrid.getGrid()[i][j]);
-        }
-    }
-    repaint();
+    drawGrid(gameGrid);
 }
 
-void LifeDisplay::advanceBoard() {
-    SimulationGrid tempGrid(gameGrid.getNumRows(), gameGrid.getNumCols());
-    // Populate the temporary grid according to the rules and the cell positions of the game grid
-    // The populating cells will wrap around the grid meaning that given the first row, if there is a cell in the first and last column,
-    // they will be considered neighbours. This will be done using mod: rowPos = rowDirection % rowLength,
-    // equivalently colPos = colDirection % colLength.
-    for (int i = 0; i < gameGrid.getNumRows(); i++) {
-        for (int j = 0; j < gameGrid.getNumCols(); j++) {
-            int rowPos = 0, colPos = 0, countNeighbours = 0;
-            for (const std::pair<int, int>& dir : directions) {
-                rowPos = (i + dir.first + gameGrid.getNumRows()) % gameGrid.getNumRows();
-                colPos = (j + dir.second + gameGrid.getNumCols()) % gameGrid.getNumCols();
-                if (gameGrid.getGrid()[rowPos][colPos] != 0) countNeighbours++;
-            }
-            // now generate the cells according to rules
-            if (countNeighbours <= 1) {
-                tempGrid.getGrid()[i][j] = 0;
-            }
-            else if (countNeighbours == 2) {
-                if (gameGrid.getGrid()[i][j] != 0) tempGrid.getGrid()[i][j]++;
-            }
-            else if (countNeighbours == 3) {
-                if (gameGrid.getGrid()[i][j] == 0) {
-                    tempGrid.getGrid()[i][j] = 1;
-                }
-                else {
-                    tempGrid.getGrid()[i][j]++;
-                }
-            }
-            else if (countNeighbours >= 4) {
-                tempGrid.getGrid()[i][j] = 0;
+void LifeDisplay::drawGrid(const SimulationGrid& grid) {
+    TRACE_SPAN("drawBoard");
+    if (grid.getNumRows() != numRows || grid.getNumCols() != numColumns) {
+        setDimensions(grid.getNumRows(), grid.getNumCols());
+    }
+    PipelineStats& stats = simulation.getStats();
+    uint64_t start = PipelineStats::now();
+    // drawCellAt only touches cells whose age changed, and only visible ovals
+    {
+        MEMORY_SCOPE(MemoryTracker::SCENE_GRAPH); // the ages themselves never allocate; the ovals might
+        for (int i = 0; i < grid.getNumRows(); i++) {
+            for (int j = 0; j < grid.getNumCols(); j++) {
+                drawCellAt(i, j, grid.getGrid()[i][j]);
             }
         }
     }
-    gameGrid = tempGrid;
-    drawBoard();
+    stats.record(PipelineStats::AGE_UPDATE, start);
+    if (isPixelMode()) {
+        start = PipelineStats::now();
+        renderPixels();
+        stats.record(PipelineStats::DRAW, start);
+    }
+    start = PipelineStats::now();
+    repaint();
+    stats.record(PipelineStats::REPAINT, start);
 }
 
-void LifeDisplay::reverseBoard(const SimulationGrid& grid) {
-    gameGrid = grid;
+bool LifeDisplay::presentLatestFrame() {
+    TRACE_SPAN("presentLatestFrame");
+    if (!simulation.pollFrame()) return false;
+    {
+        MEMORY_SCOPE(MemoryTracker::RENDERER);
+        gameGrid = simulation.getFrame().grid;
+    }
     drawBoard();
+    return true;
 }
 
 void LifeDisplay::setMode(const std::string& mode) {
     this->mode = mode;
-    if (mode == "1") {
-        timerDelay = timerDelayMode1;
-    }
-    else if (mode == "2") {
-        timerDelay = timerDelayMode2;
-    }
-    else if (mode == "3") {
-        timerDelay = timerDelayMode3;
-    }
 }
 
 std::string& LifeDisplay::getMode() {
     return mode;
 }
 
-double LifeDisplay::getTimerDelay() const {
-    return timerDelay;
-}
-
 GWindow* LifeDisplay::getWindow() const {
     return window;
 }
@@ -239,6 +377,81 @@ SimulationGrid& LifeDisplay::getGrid() {
     return gameGrid;
 }
 
-GridStack<SimulationGrid*>& LifeDisplay::getUndoButtonStack() {
-    return undoButtonStack;
+SimulationWorker& LifeDisplay::getSimulation() {
+    return simulation;
+}
+
+void LifeDisplay::startReplay(RecordingReader* recording) {
+    replaying = true;
+    simulation.startReplay(recording);
+    presentLatestFrame();
+}
+
+bool LifeDisplay::isReplaying() const {
+    return replaying;
+}
+
+void LifeDisplay::setStatsVisible(bool visible) {
+    statsVisible = visible;
+    statsLabel->setVisible(visible);
+    if (visible) MemoryTracker::setEnabled(true); // off by default in release builds
+    lastStatsUpdate = 0; // show fresh numbers right away
+}
+
+bool LifeDisplay::isStatsVisible() const {
+    return statsVisible;
+}
+
+void LifeDisplay::showStats(const SimulationWorker::Frame& frame) {
+    if (!statsVisible) return;
+    const double kStatsInterval = 250; // ms between updates of the text
+    double now = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (now - lastStatsUpdate < kStatsInterval) return;
+    lastStatsUpdate = now;
+
+    ostringstream text;
+    text << fixed << setprecision(1)
+         << "generation " << frame.generation << "   population " << frame.population
+         << "   " << frame.achievedGenerationsPerSecond << " gen/s";
+    if (frame.playing) {
+        text << " of ";
+        if (std::isinf(frame.targetGenerationsPerSecond)) text << "max";
+        else text << frame.targetGenerationsPerSecond;
+    }
+    text << "\nms p50/p99:" << setprecision(2);
+    const PipelineStats& stats = simulation.getStats();
+    for (int stage = 0; stage < PipelineStats::kNumStages; stage++) {
+        PipelineStats::Summary summary = stats.summarize(static_cast<PipelineStats::Stage>(stage));
+        text << "  " << PipelineStats::getStageName(static_cast<PipelineStats::Stage>(stage)) << " ";
+        if (summary.samples == 0) {
+            text << "-";
+        }
+        else {
+            text << summary.p50 << "/" << summary.p99;
+        }
+    }
+
+    // allocations per generation since the last update, and bytes still held
+    MemoryTracker::Snapshot memory = MemoryTracker::getSnapshot();
+    long long generations = frame.generation - lastStatsGeneration;
+    text << "\nallocs/gen, live KB:" << setprecision(1);
+    for (int subsystem = 0; subsystem < MemoryTracker::kNumSubsystems; subsystem++) {
+        const MemoryTracker::Usage& usage = memory.usage[subsystem];
+        long long allocations = usage.allocations - lastMemory.usage[subsystem].allocations;
+        text << "  " << MemoryTracker::getSubsystemName(static_cast<MemoryTracker::Subsystem>(subsystem)) << " ";
+        if (generations > 0) {
+            text << static_cast<double>(allocations) / generations;
+        }
+        else {
+            text << "-";
+        }
+        text << ", " << usage.liveBytes / 1024.0;
+    }
+    if (!MemoryTracker::isCompiledIn()) {
+        text << "  (tracking compiled out)";
+    }
+    lastMemory = memory;
+    lastStatsGeneration = frame.generation;
+    statsLabel->setText(text.str());
 }
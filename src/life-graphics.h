@@ -7,12 +7,17 @@
 
 #pragma once
 #include <string>    // for std::string
+#include <vector>    // for std::vector
 #include "gwindow.h" // for GWindow
 #include "gobjects.h" // for GOval
+#include "glabel.h"  // for GLabel
 #include "vector.h"  // for Vector
 #include "grid.h"    // for Grid
 #include "simulationgrid.h" // for SimulationGrid
-#include "gridstack.h" // for GridStack
+#include "agepyramid.h" // for AgePyramid
+#include "simulationworker.h" // for SimulationWorker
+#include "memorytracker.h" // for MemoryTracker
+#include "recording.h" // for RecordingReader
 
 class GWindow;
 
@@ -38,8 +43,8 @@ public:
  * border around the simulation rectangle which is centered in the
  * window.  The grid cells will be sized as large as will fit given
  * the grid geometry. Grids with more rows and columns will use smaller
- * cells. This function can be used at the beginning of a simulation or
- * between generations to clear the window before drawing the next generation.
+ * cells. The viewport is reset so that the whole grid is visible.
+ * drawBoard calls this itself whenever the grid dimensions change.
  */
     void setDimensions(int rows, int cols);
     
@@ -79,17 +84,43 @@ public:
   */
     void printBoard();
 
+/**
+ * Draws the current game grid. Only cells inside the viewport are drawn:
+ * when cells are large enough they are drawn as individual ovals, otherwise
+ * the visible area is shaded pixel by pixel from a downsampled age map.
+ */
     void drawBoard();
 
-    void advanceBoard();
-
-    void reverseBoard(const SimulationGrid& grid);
+/**
+ * Copies the most recent frame published by the simulation worker into the
+ * game grid and draws it, if there is one that has not been drawn yet.
+ * Frames published since the last call other than the newest one are
+ * skipped. Returns whether anything was drawn.
+ */
+    bool presentLatestFrame();
 
     void setMode(const std::string&  mode);
 
     std::string& getMode();
 
-    double getTimerDelay() const;
+/**
+ * Zooms the viewport in or out by a factor of two around its center and
+ * redraws. Zooming out stops once the whole grid is visible; zooming in
+ * stops once cells reach kMaxCellDiameter pixels.
+ */
+    void zoomIn();
+    void zoomOut();
+
+/**
+ * Scrolls the viewport by the given number of steps (an eighth of the
+ * visible area each) and redraws. Positive values move down/right.
+ */
+    void pan(int rowSteps, int columnSteps);
+
+/**
+ * Zooms back out so that the whole grid is visible.
+ */
+    void resetView();
  /**
   * Provides access to the GWindow field as event listeners will be attached to it
   */
@@ -97,32 +128,85 @@ public:
 
     SimulationGrid& getGrid();
 
-    GridStack<SimulationGrid*>& getUndoButtonStack();
+/**
+ * Provides access to the worker that computes generations; event listeners
+ * queue their commands on it and never touch the grid themselves.
+ */
+    SimulationWorker& getSimulation();
+
+/**
+ * Plays back a recording instead of simulating, taking ownership of it, and
+ * draws its first frame. Call instead of getSimulation().start; the worker's
+ * commands then move through the recording (see SimulationWorker::startReplay).
+ */
+    void startReplay(RecordingReader* recording);
+    bool isReplaying() const;
+
+/**
+ * Shows or hides the statistics line under the board: generation, population,
+ * achieved and requested speed, the median and 99th percentile time of each
+ * pipeline stage, and each subsystem's heap allocations per generation and
+ * live bytes. The timings are collected whether or not it is shown; showing
+ * it turns allocation tracking on.
+ */
+    void setStatsVisible(bool visible);
+    bool isStatsVisible() const;
+
+/**
+ * Refreshes the statistics line from the given frame, if it is visible.
+ * Meant to be called every frame; the text only changes a few times a second
+ * so that it stays readable and cheap.
+ */
+    void showStats(const SimulationWorker::Frame& frame);
 
     
 private:
     GWindow* window;
-    SimulationGrid gameGrid;
-    GridStack<SimulationGrid*> undoButtonStack;
+    SimulationGrid gameGrid; // the generation currently on screen
     int numRows;
     int numColumns;
     double upperLeftX;
     double upperLeftY;
     double cellDiameter;
-    double timerDelay;
+    double fitCellDiameter; // cell size at which the whole grid fits the window
+    double zoom; // 1 when the whole grid fits, doubled by each zoomIn
+    int firstVisibleRow;
+    int firstVisibleColumn;
+    int visibleRows;
+    int visibleColumns;
     Vector<std::string> colors;
+    Vector<int> colorValues; // same shades as colors, as RGB integers for pixel drawing
     std::string windowTitle;
     std::string mode;
     Grid<int> ages;
-    Grid<GOval*> cells; // to avoid redrawing duplicate cells
+    AgePyramid agePyramid; // downsampled ages for zoomed-out drawing
+    Grid<GOval*> cells; // one oval per visible cell, reused across generations
+    std::vector<unsigned int> pixels; // ARGB buffer covering the board and its border, for zoomed-out drawing
+    SimulationWorker simulation;
+    bool replaying;
+    GLabel* statsLabel; // in the window's south region; the window owns it
+    bool statsVisible;
+    double lastStatsUpdate; // in ms of steady_clock time
+    long long lastStatsGeneration;
+    MemoryTracker::Snapshot lastMemory; // allocation totals as of the last statistics update
     
     static const std::string kDefaultWindowTitle;
     static const int kDisplayWidth = 10 * 72; // 10 inches
     static const int kDisplayHeight = 7 * 72; // 7 inches
+    static const int kMinOvalDiameter = 4; // smaller cells are drawn as pixels
+    static const int kMaxCellDiameter = 64;
     
     void initializeColors();
+    void drawGrid(const SimulationGrid& grid);
     void fillCellGrid();
-    int scalePrimaryColor(int baseContribution, int age) const;
+    void clearCellGrid();
+    void layoutViewport();
+    void setZoom(double zoom);
+    void refreshVisibleCells();
+    void drawOval(GOval* oval, int age);
+    void renderPixels();
+    int shadeAt(int level, int row, int column) const;
+    bool isPixelMode() const;
     void computeGeometry();
     bool coordinateInRange(int row, int column) const;
     
@@ -6,10 +6,16 @@
  */
 
 #include <iostream> // for cout
-#include <fstream> // for ifstream
+#include <stdexcept> // for runtime_error
 #include <sstream> // for stringstream
-#include <random> // for uniform_int_distribution
 #include <utility> // for std::pair
+#include <cmath> // for pow
+#include <limits> // for numeric_limits
+#include <iomanip> // for setprecision
+#include <chrono> // for steady_clock
+#include <cstdlib> // for getenv, strtoull
+#include <cstdint> // for uint64_t
+#include <vector> // for std::vector
 
 #include "console.h" // required of all files that contain the main function
 #include "simpio.h" // for getLine
@@ -18,153 +24,306 @@
 #include "gslider.h" // for GSlider
 #include "strlib.h"
 
-#include "life-constants.h"  // for kMaxAge
+#include "life-constants.h"  // for kSpeedSteps
 #include "life-graphics.h"   // for class LifeDisplay
+#include "patternio.h"       // for readPatternFile
+#include "tracing.h"         // for Tracer
+#include "logger.h"          // for LOG_DEBUG
+#include "snapshot.h"        // for writeSnapshot
+#include "recording.h"       // for RecordingReader
+#include "patterncatalogue.h" // for PatternCatalogue
+#include "soup.h"            // for fillRandomSoup
+#include "liferule.h"        // for LifeRule
+
+static const std::string kSnapshotFile = "life.snap";
+static const std::string kRecordingFile = "life.rec";
+static const std::string kCatalogueFile = "life-patterns.idx";
+static uint64_t startSeed = 0; // the random board's seed, or the one a snapshot was saved with
+static LifeRule startRule;     // the rule the pattern file or snapshot names; B3/S23 otherwise
 
 /**
- * Function: setupFromFile
- * -----------------
- * Populates a grid by reading the
+ * Function: patternDirectories
+ * ----------------------------
+ * Returns the directories whose patterns are offered at startup: files,
+ * followed by those listed in LIFE_PATTERN_PATH (separated like PATH).
  */
-void setupGrid(const std::string& option, SimulationGrid& startGrid) {
-    if (option == "f") {
-        std::cout << "Enter the name of the configuration file as files/<filename>. Then press enter." << std::endl;
-        std::string filename;
-        std::getline(std::cin, filename);
-        std::ifstream configFileStream;
-        configFileStream.open(filename);
-        while (!configFileStream) {
-            std::cout << "This file seems to not exist, please enter a different one. Then press enter." << std::endl;
-            configFileStream.close();
-            std::getline(std::cin, filename);
-            configFileStream.open(filename);
-        }
-        std::string currentLine;
-        std::getline(configFileStream, currentLine);
-        while (currentLine[0] == '#') {
-            std::getline(configFileStream, currentLine);
-        }
-        int numRows, numCols;
-        numRows = std::stoi(currentLine);
-        std::getline(configFileStream, currentLine);
-        numCols = std::stoi(currentLine);
-        startGrid.setGridFieldsEmpty(numRows, numCols);
-        for (int i = 0; i < numRows; i++) {
-            std::getline(configFileStream, currentLine);
-            for (int j = 0; j < numCols; j++) {
-                if (currentLine[j] == '-') {
-                    startGrid.getGrid()[i][j] = 0;
-                }
-                else if (currentLine[j] == 'X') {
-                    startGrid.getGrid()[i][j] = 1;
-                }
-            }
+static std::vector<std::string> patternDirectories() {
+#ifdef _WIN32
+    const char kSeparator = ';';
+#else
+    const char kSeparator = ':';
+#endif
+    std::vector<std::string> directories = { "files" };
+    const char* path = std::getenv("LIFE_PATTERN_PATH");
+    std::stringstream entries(path != nullptr ? path : "");
+    std::string directory;
+    while (std::getline(entries, directory, kSeparator)) {
+        if (!directory.empty()) directories.push_back(directory);
+    }
+    return directories;
+}
+
+/**
+ * Function: choosePatternFile
+ * ---------------------------
+ * Lists the catalogued patterns and returns the one the user picks by
+ * number, or whatever file name the user types instead.
+ */
+static std::string choosePatternFile() {
+    PatternCatalogue catalogue(kCatalogueFile);
+    catalogue.scan(patternDirectories());
+    const std::vector<PatternSummary>& patterns = catalogue.getPatterns();
+    for (size_t i = 0; i < patterns.size(); i++) {
+        const PatternSummary& pattern = patterns[i];
+        std::cout << std::setw(4) << i + 1 << ". " << std::left << std::setw(24) << pattern.getName() << std::right;
+        if (!pattern.error.empty()) {
+            std::cout << "(unreadable)" << std::endl;
+            continue;
         }
-        configFileStream.close();
-    }
-    else { // randomize the grid
-        std::random_device rd;  // Will be used to obtain a seed for the random number engine
-        std::mt19937 gen(rd()); // Standard mersenne_twister_engine seeded with rd()
-        std::uniform_int_distribution<> numRowsGenerator(40, 60);
-        std::uniform_int_distribution<> numColsGenerator(40, 60);
-        std::uniform_int_distribution<> unoccupiedOrOccupied(0, 1);
-        std::uniform_int_distribution<> ageGenerator(1, kMaxAge);
-        int numRows, numCols;
-        numRows = numRowsGenerator(gen);
-        numCols = numColsGenerator(gen);
-        startGrid.setGridFieldsEmpty(numRows, numCols);
-        for (int i = 0; i < numRows; i++) {
-            for (int j = 0; j < numCols; j++) {
-                if (unoccupiedOrOccupied(gen) == 1) {
-                    startGrid.getGrid()[i][j] = ageGenerator(gen);
+        std::cout << pattern.numRows << "x" << pattern.numCols << ", " << pattern.population << " cells";
+        if (pattern.period == 1) std::cout << ", still life";
+        else if (pattern.period > 1) std::cout << ", period " << pattern.period;
+        if (pattern.rule != "B3/S23") std::cout << ", rule " << pattern.rule;
+        std::cout << std::endl;
+    }
+    std::cout << "Enter the number of a pattern above, or the name of a configuration file (plaintext or RLE) as files/<filename>. Then press enter." << std::endl;
+    std::string choice;
+    std::getline(std::cin, choice);
+    if (!choice.empty() && choice.size() < 10 && choice.find_first_not_of("0123456789") == std::string::npos) {
+        size_t number = std::stoul(choice);
+        if (number >= 1 && number <= patterns.size()) return patterns[number - 1].path;
+    }
+    return choice;
+}
+
+/**
+ * Function: setupGrid
+ * ------------------
+ * Populates a grid by reading a pattern file (option "f"), picked from the
+ * catalogue or named by the user, or at random.
+ * When the file is a saved snapshot, the run resumes from the generation
+ * it was saved at, which is stored in startGeneration. The rule a snapshot,
+ * RLE or macrocell file names is stored in startRule.
+ */
+void setupGrid(const std::string& option, SimulationGrid& startGrid, long long& startGeneration) {
+    if (option == "f") {
+        std::string filename = choosePatternFile();
+        while (true) {
+            try {
+                startRule = LifeRule(); // a file that failed part way may have set it
+                if (isSnapshotFile(filename)) {
+                    SnapshotInfo info;
+                    readSnapshot(filename, startGrid, &info);
+                    startGeneration = info.generation;
+                    startSeed = info.seed;
+                    startRule = info.rule;
                 }
                 else {
-                    startGrid.getGrid()[i][j] = 0;
+                    readPatternFile(filename, startGrid, &startRule);
                 }
+                if (startRule != LifeRule()) {
+                    std::cout << "This pattern runs under the rule " << startRule.toString()
+                              << " instead of the rules above." << std::endl;
+                }
+                break;
+            }
+            catch (const std::runtime_error& ex) {
+                std::cout << ex.what() << std::endl;
+                std::cout << "Please enter a different file. Then press enter." << std::endl;
+                std::getline(std::cin, filename);
             }
         }
     }
+    else { // randomize the grid, reproducibly: LIFE_SEED picks the board
+        const char* seedText = std::getenv("LIFE_SEED");
+        startSeed = seedText != nullptr ? std::strtoull(seedText, nullptr, 10) : makeRandomSeed();
+        int numRows = seededRandomInt(startSeed, 0, 40, 60);
+        int numCols = seededRandomInt(startSeed, 1, 40, 60);
+        fillRandomSoup(startGrid, numRows, numCols, startSeed, 0.5, true);
+        std::cout << "Random board from seed " << startSeed << "; set LIFE_SEED to it to get the same board again." << std::endl;
+    }
+}
+
+/**
+ * Function: openRecording
+ * -----------------------
+ * Asks for a recording to play back until one can be opened.
+ */
+static RecordingReader* openRecording() {
+    std::cout << "Enter the name of the recording, such as " << kRecordingFile << ". Then press enter." << std::endl;
+    std::string filename;
+    std::getline(std::cin, filename);
+    while (true) {
+        try {
+            return new RecordingReader(filename);
+        }
+        catch (const std::runtime_error& ex) {
+            std::cout << ex.what() << std::endl;
+            std::cout << "Please enter a different file. Then press enter." << std::endl;
+            std::getline(std::cin, filename);
+        }
+    }
 }
 
 /**
  * Function: welcome
  * -----------------
- * Introduces the user to the Game of Life and its rules.
+ * Introduces the user to the Game of Life and its rules. Returns the
+ * recording to play back if the user chose one, or nullptr.
  */
-static void welcome(SimulationGrid& startGrid) {
+static RecordingReader* welcome(SimulationGrid& startGrid, long long& startGeneration) {
     std::cout << "Welcome to the game of Life, a simulation of the lifecycle of a bacteria colony." << std::endl;
     std::cout << "Cells live and die by the following rules:" << std::endl << std::endl;
     std::cout << "\tA cell with 1 or fewer neighbors dies of loneliness" << std::endl;
     std::cout << "\tLocations with 2 neighbors remain stable" << std::endl;
     std::cout << "\tLocations with 3 neighbors will spontaneously create life" << std::endl;
     std::cout << "\tLocations with 4 or more neighbors die of overcrowding" << std::endl << std::endl;
-    std::cout << "In the animation, new cells are dark and fade to gray as they age." << std::endl << std::endl;
-    std::cout << "Type f to choose a starting configuration from a file, or type r for a random one. Then hit enter." << std::endl << std::endl;
+    std::cout << "In the animation, new cells are dark and fade to gray as they age." << std::endl;
+    std::cout << "Use + and - (or the mouse wheel) to zoom, the arrow keys to pan and 0 to see the whole board." << std::endl;
+    std::cout << "Press h to show or hide timing statistics under the board, and t to start or stop a trace." << std::endl;
+    std::cout << "Press s to save a snapshot of the board to " << kSnapshotFile << "; open it as a file to resume." << std::endl;
+    std::cout << "Press r to start or stop recording every generation to " << kRecordingFile << "." << std::endl << std::endl;
+    std::cout << "Type f to choose a starting configuration from a file, r for a random one, or p to play back a recording. Then hit enter." << std::endl << std::endl;
     std::string startingOption;
     std::getline(std::cin, startingOption);
-    while (startingOption != "f" && startingOption != "r") {
-        std::cout << "Type f to choose a starting configuration from a file, or type r for a random one. Then hit enter." << std::endl;
+    while (startingOption != "f" && startingOption != "r" && startingOption != "p") {
+        std::cout << "Type f to choose a starting configuration from a file, r for a random one, or p to play back a recording. Then hit enter." << std::endl;
         std::getline(std::cin, startingOption);
     }
-    setupGrid(startingOption, startGrid);
+    if (startingOption == "p") {
+        return openRecording();
+    }
+    setupGrid(startingOption, startGrid, startGeneration);
+    return nullptr;
+}
+
+/**
+ * Function: setButtonEnabled
+ * --------------------------
+ * Enables or disables the button with the given name in the display's window.
+ */
+static void setButtonEnabled(GWindow* window, const std::string& name, bool enabled) {
+    for (GInteractor* interactor: window->getContainer()->getDescendents()) {
+        if (interactor->getName() == name) {
+            interactor->setEnabled(enabled);
+        }
+    }
 }
 
+static bool isButtonEnabled(GWindow* window, const std::string& name) {
+    for (GInteractor* interactor: window->getContainer()->getDescendents()) {
+        if (interactor->getName() == name) {
+            return interactor->isEnabled();
+        }
+    }
+    return false;
+}
+
+/**
+ * Function: sliderToGenerationsPerSecond
+ * --------------------------------------
+ * Maps a position of the speed slider to a generations-per-second target.
+ * Positions 1 to kSpeedSteps - 1 are spread evenly on a logarithmic scale
+ * between kMinGenerationsPerSecond and kMaxGenerationsPerSecond; the last
+ * position means as fast as possible. Position 0 (stopped) is not a speed.
+ */
+static double sliderToGenerationsPerSecond(int sliderValue) {
+    if (sliderValue >= kSpeedSteps) return std::numeric_limits<double>::infinity();
+    double fraction = (sliderValue - 1) / double(kSpeedSteps - 2);
+    return kMinGenerationsPerSecond * std::pow(kMaxGenerationsPerSecond / kMinGenerationsPerSecond, fraction);
+}
+
+/**
+ * Function: windowTitle
+ * ---------------------
+ * Returns the window title for a frame: whether a recording is being played
+ * back or made and, while playing, the achieved and requested speed.
+ */
+static std::string windowTitle(const LifeDisplay* display, const SimulationWorker::Frame& frame) {
+    std::ostringstream title;
+    title << (display->isReplaying() ? "Game of Life replay" : "Game of Life");
+    if (frame.recording) title << " (recording)";
+    if (!frame.playing) return title.str();
+    title << " - " << std::fixed << std::setprecision(1)
+          << frame.achievedGenerationsPerSecond << " of ";
+    if (std::isinf(frame.targetGenerationsPerSecond)) {
+        title << "max";
+    }
+    else {
+        title << frame.targetGenerationsPerSecond;
+    }
+    title << " gen/s";
+    return title.str();
+}
+
+static std::chrono::steady_clock::time_point lastTimerRing; // for measuring timer dispatch delay
+
+/**
+ * Function: timerRing
+ * -------------------
+ * Fires every kFrameDelay ms for the whole run of the program. Generations
+ * are computed by the display's simulation worker; this only draws the newest
+ * one, if any, and keeps the undo button in step with what can be undone.
+ */
 void timerRing(GTimerEvent e) {
-    std::cout << "Timer ringing" << std::endl;
-    std::cout << e.getSource()->getType() << std::endl;
+    TRACE_SPAN("timerRing");
     LifeDisplay* display = e.getSource()->getWindow()->getDisplay();
-    SimulationGrid* currentGrid = new SimulationGrid(display->getGrid());
-    display->getUndoButtonStack().pushGrid(currentGrid);
-    display->advanceBoard();
+    GWindow* window = display->getWindow();
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (lastTimerRing.time_since_epoch().count() != 0) {
+        double late = std::chrono::duration<double, std::milli>(now - lastTimerRing).count() - kFrameDelay;
+        display->getSimulation().getStats().recordMillis(PipelineStats::TIMER_DISPATCH, late);
+    }
+    lastTimerRing = now;
+    if (!display->presentLatestFrame()) {
+        display->showStats(display->getSimulation().getFrame());
+        return;
+    }
+    const SimulationWorker::Frame& frame = display->getSimulation().getFrame();
+    LOG_DEBUG("timerRing source=" << e.getSource()->getType() << " generation=" << frame.generation
+              << " population=" << frame.population);
+    // undo is only offered while stepping by hand, i.e. while "=>" is enabled
+    setButtonEnabled(window, "<=", !frame.playing && frame.undoDepth > 0 && isButtonEnabled(window, "=>"));
+    display->setTitle(windowTitle(display, frame));
+    display->showStats(frame);
 }
 
 void advanceGenerationBtnPressed(GActionEvent e) {
-    std::cout << e.getInteractor()->getType() << std::endl;
+    LOG_DEBUG("advanceGenerationBtnPressed source=" << e.getInteractor()->getType());
     LifeDisplay* display = e.getInteractor()->getWindow()->getDisplay();
-    SimulationGrid* currentGrid = new SimulationGrid(display->getGrid());
-    display->getUndoButtonStack().pushGrid(currentGrid);
-    display->advanceBoard();
-    for (GInteractor* interactor: e.getInteractor()->getContainer()->getInteractors()) {
-        if (interactor->getName() == "<=") {
-            interactor->setEnabled(true);
-        }
-    }
+    display->getSimulation().step(); // "<=" is enabled by timerRing once the step is shown
 }
 
 void reverseGenerationBtnPressed(GActionEvent e) {
-    std::cout << e.getInteractor()->getType() << std::endl;
+    LOG_DEBUG("reverseGenerationBtnPressed source=" << e.getInteractor()->getType());
     LifeDisplay* display = e.getInteractor()->getWindow()->getDisplay();
-    SimulationGrid* previousGrid = display->getUndoButtonStack().popGrid();
-    if (display->getUndoButtonStack().getStackSize() == 0) e.getInteractor()->setEnabled(false);
-    display->reverseBoard(*previousGrid);
-    delete previousGrid;
+    if (display->getSimulation().getFrame().undoDepth <= 1) e.getInteractor()->setEnabled(false);
+    display->getSimulation().undo();
 }
 
 void sliderSettingChanged(GActionEvent e) {
-    std::cout << e.getInteractor()->getType() << std::endl;
+    LOG_DEBUG("sliderSettingChanged source=" << e.getInteractor()->getType()
+              << " value=" << e.getInteractor()->getSlider()->getValue());
     LifeDisplay* display = e.getInteractor()->getWindow()->getDisplay();
-    GWindow* window = e.getInteractor()->getWindow();
     const GSlider* slider = e.getInteractor()->getSlider();
-    if (display->getMode() != "m") {
-        window->removeTimerListener(display->getTimerDelay());
-    }
+    bool wasAdvancing = display->getMode() != "m";
     int sliderValue = slider->getValue();
     std::string mode;
-    if (sliderValue > 1) {
-        //GEventListener timerRingListener = timerRing;
-        if (sliderValue == 2) mode = "1";
-        else if (sliderValue == 3) mode = "2";
-        else if (sliderValue == 4) mode = "3";
+    if (sliderValue > 0) {
+        mode = "a";
         display->setMode(mode);
-        window->setTimerListener(display->getTimerDelay(), timerRing);
+        display->getSimulation().setGenerationsPerSecond(sliderToGenerationsPerSecond(sliderValue));
+        if (!wasAdvancing) display->getSimulation().play();
     }
     else {
         mode = "m";
+        if (wasAdvancing) display->getSimulation().pause();
         display->setMode(mode);
     }
 }
 
 void manualOrAutoBtnPressed(GActionEvent e) {
+    LOG_DEBUG("manualOrAutoBtnPressed command=" << e.getInteractor()->getActionCommand());
     if (e.getInteractor()->getActionCommand() == ">") {
         std::string pauseText = "||";
         e.getInteractor()->setActionCommand(pauseText);
@@ -178,23 +337,21 @@ void manualOrAutoBtnPressed(GActionEvent e) {
                 interactor->setEnabled(true);
                 const GSlider* slider = interactor->getSlider();
                 int sliderValue = slider->getValue();
-                if (sliderValue > 1) {
-                    //GEventListener timerRingListener = timerRing;
-                    std::string mode;
-                    if (sliderValue == 2) mode = "1";
-                    else if (sliderValue == 3) mode = "2";
-                    else if (sliderValue == 4) mode = "3";
+                if (sliderValue > 0) {
+                    std::string mode = "a";
                     LifeDisplay* display = e.getInteractor()->getWindow()->getDisplay();
-                    GWindow* window = e.getInteractor()->getWindow();
                     display->setMode(mode);
-                    window->setTimerListener(display->getTimerDelay(), timerRing);
+                    display->getSimulation().setGenerationsPerSecond(sliderToGenerationsPerSecond(sliderValue));
+                    display->getSimulation().play();
                 }
             }
         }
     }
     else if (e.getInteractor()->getActionCommand() == "||") {
         LifeDisplay* display = e.getInteractor()->getWindow()->getDisplay();
-        GWindow* window = e.getInteractor()->getWindow();
+        // also when nothing was playing: the frame the worker publishes in
+        // response lets timerRing re-enable "<=" if there is anything to undo
+        display->getSimulation().pause();
         std::string playText = ">";
         e.getInteractor()->setActionCommand(playText);
         GButton* button = e.getInteractor()->getButton();
@@ -203,35 +360,133 @@ void manualOrAutoBtnPressed(GActionEvent e) {
             if (interactor->getName() == "=>") {
                 interactor->setEnabled(true);
             }
-            else if (interactor->getName() == "<=") {
-                if (display->getUndoButtonStack().getStackSize() > 0) {
-                    interactor->setEnabled(true);
-                }
-                else {
-                    interactor->setEnabled(false);
-                }
-            }
             else if (interactor->getName() == "diffSpeeds") {
                 interactor->setEnabled(false);
             }
         }
-        if (display->getMode() != "m") {
-            window->removeTimerListener(display->getTimerDelay());
-        }
         std::string mode = "m";
         display->setMode(mode);
     }
 }
 
+/**
+ * Function: toggleTracing
+ * -----------------------
+ * Starts recording a trace, or stops recording and writes it to kTraceFile
+ * for viewing in Perfetto or chrome://tracing.
+ */
+static void toggleTracing() {
+    const std::string kTraceFile = "life-trace.json";
+    if (!Tracer::isEnabled()) {
+        Tracer::setEnabled(true);
+        LOG_INFO("tracing started; press t again to stop and save it");
+    }
+    else {
+        Tracer::setEnabled(false);
+        if (Tracer::writeChromeTrace(kTraceFile)) {
+            LOG_INFO("trace written to " << kTraceFile);
+        }
+        else {
+            LOG_ERROR("could not write trace " << kTraceFile);
+        }
+    }
+}
+
+/**
+ * Function: saveSnapshot
+ * ----------------------
+ * Writes the generation on screen to kSnapshotFile so the run can be resumed.
+ */
+static void saveSnapshot(LifeDisplay* display) {
+    const SimulationWorker::Frame& frame = display->getSimulation().getFrame();
+    SnapshotInfo info;
+    info.generation = frame.generation;
+    info.seed = startSeed;
+    info.rule = startRule;
+    try {
+        writeSnapshot(kSnapshotFile, frame.grid, info);
+        LOG_INFO("generation " << frame.generation << " saved to " << kSnapshotFile);
+    }
+    catch (const std::runtime_error& ex) {
+        LOG_ERROR(ex.what());
+    }
+}
+
+/**
+ * Function: toggleRecording
+ * -------------------------
+ * Starts recording every generation from the one on screen to
+ * kRecordingFile, or stops recording. Does nothing during playback, which
+ * may be reading kRecordingFile.
+ */
+static void toggleRecording(LifeDisplay* display) {
+    if (display->getSimulation().getFrame().recording) {
+        display->getSimulation().stopRecording();
+        LOG_INFO("recording stopped; play it back by starting with p");
+    }
+    else if (display->isReplaying()) {
+        LOG_WARNING("cannot record while playing back a recording");
+    }
+    else {
+        display->getSimulation().startRecording(kRecordingFile); // press r again to stop
+    }
+}
+
+void keyPressed(GKeyEvent e) {
+    if (e.getEventType() != KEY_PRESSED) return;
+    LifeDisplay* display = e.getSource()->getWindow()->getDisplay();
+    switch (e.getKeyCode()) {
+        case GEvent::UP_ARROW_KEY:    display->pan(-1, 0); return;
+        case GEvent::DOWN_ARROW_KEY:  display->pan(1, 0);  return;
+        case GEvent::LEFT_ARROW_KEY:  display->pan(0, -1); return;
+        case GEvent::RIGHT_ARROW_KEY: display->pan(0, 1);  return;
+    }
+    char key = e.getKeyChar();
+    if (key == '+' || key == '=') {
+        display->zoomIn();
+    }
+    else if (key == '-') {
+        display->zoomOut();
+    }
+    else if (key == '0') {
+        display->resetView();
+    }
+    else if (key == 'h' || key == 'H') {
+        display->setStatsVisible(!display->isStatsVisible());
+    }
+    else if (key == 't' || key == 'T') {
+        toggleTracing();
+    }
+    else if (key == 's' || key == 'S') {
+        saveSnapshot(display);
+    }
+    else if (key == 'r' || key == 'R') {
+        toggleRecording(display);
+    }
+}
+
+void mouseWheelMoved(GMouseEvent e) {
+    LifeDisplay* display = e.getSource()->getWindow()->getDisplay();
+    if (e.getEventType() == MOUSE_WHEEL_UP) {
+        display->zoomIn();
+    }
+    else if (e.getEventType() == MOUSE_WHEEL_DOWN) {
+        display->zoomOut();
+    }
+}
+
 /**
  * Function: main
  * --------------
  * Provides the entry point of the entire program.
  */
 int main() {
+    Logger::setLevel(Logger::parseLevel(std::getenv("LIFE_LOG_LEVEL")));
+    Tracer::setThreadName("main");
     LifeDisplay display;
     display.setTitle("Game of Life");
-    welcome(display.getGrid());
+    long long startGeneration = 0;
+    RecordingReader* replay = welcome(display.getGrid(), startGeneration);
 
     std::string advanceGenerationText = "=>";
     GButton advanceGenerationBtn(advanceGenerationText);
@@ -255,7 +510,7 @@ int main() {
     GInteractor* interactorManualOrAutoModeBtn = &manualOrAutoModeBtn;
     interactorManualOrAutoModeBtn->setName(manualOrAutoModeString);
     std::string diffAdvanceSpeedsString = "diffSpeeds";
-    GSlider diffAdvanceSpeeds(1, 4, 1);
+    GSlider diffAdvanceSpeeds(0, kSpeedSteps, 0);
     diffAdvanceSpeeds.setHeight(50.0);
     diffAdvanceSpeeds.setWidth(50.0);
     diffAdvanceSpeeds.setWindow(display.getWindow());
@@ -282,8 +537,17 @@ int main() {
     reverseGenerationBtn.setActionListener(reverseGenerationBtnPressed);
     diffAdvanceSpeeds.setActionListener(sliderSettingChanged);
     // diffAdvanceSpeeds.setActionListener(sliderSettingChangedListener);
+    display.getWindow()->setKeyListener(keyPressed);
+    display.getWindow()->setMouseListener(mouseWheelMoved);
 
-    display.drawBoard();
+    if (replay) {
+        display.startReplay(replay);
+    }
+    else {
+        display.drawBoard();
+        display.getSimulation().start(display.getGrid(), startGeneration, startRule);
+    }
+    display.getWindow()->setTimerListener(kFrameDelay, timerRing);
     display.getWindow()->requestFocus();
     getLine("Hit [enter] to continue....   ");
     return 0;